@@ -46,6 +46,9 @@
 #define RANDOM_SEED_SET_TAG "random_seed_set"
 #define RANDOM_SEED_TAG "random_seed"
 #define INIT_MODEL_TAG "init_model"
+#define LATENT_SAMPLER_TAG "latent_sampler"
+#define RESIDUAL_CACHE_TAG "residual_cache"
+#define RANDOM_GENERATOR_TAG "random_generator"
 #define CLASSIFY_TAG "classify"
 #define THRESHOLD_TAG "threshold"
 
@@ -121,6 +124,60 @@ std::string smurff::modelInitTypeToString(ModelInitTypes type)
    }
 }
 
+LatentSamplerTypes smurff::stringToLatentSamplerType(std::string name)
+{
+   if(name == LATENT_SAMPLER_NAME_SINGLE)
+      return LatentSamplerTypes::single;
+   else if (name == LATENT_SAMPLER_NAME_BATCHED)
+      return LatentSamplerTypes::batched;
+   else
+   {
+      THROWERROR("Invalid latent sampler type " + name);
+   }
+}
+
+std::string smurff::latentSamplerTypeToString(LatentSamplerTypes type)
+{
+   switch(type)
+   {
+      case LatentSamplerTypes::single:
+         return LATENT_SAMPLER_NAME_SINGLE;
+      case LatentSamplerTypes::batched:
+         return LATENT_SAMPLER_NAME_BATCHED;
+      default:
+      {
+         THROWERROR("Invalid latent sampler type");
+      }
+   }
+}
+
+RandomGeneratorTypes smurff::stringToRandomGeneratorType(std::string name)
+{
+   if(name == RANDOM_GENERATOR_NAME_MT19937)
+      return RandomGeneratorTypes::mt19937;
+   else if (name == RANDOM_GENERATOR_NAME_PHILOX)
+      return RandomGeneratorTypes::philox;
+   else
+   {
+      THROWERROR("Invalid random generator type " + name);
+   }
+}
+
+std::string smurff::randomGeneratorTypeToString(RandomGeneratorTypes type)
+{
+   switch(type)
+   {
+      case RandomGeneratorTypes::mt19937:
+         return RANDOM_GENERATOR_NAME_MT19937;
+      case RandomGeneratorTypes::philox:
+         return RANDOM_GENERATOR_NAME_PHILOX;
+      default:
+      {
+         THROWERROR("Invalid random generator type");
+      }
+   }
+}
+
 //config
 ActionTypes Config::ACTION_DEFAULT_VALUE = ActionTypes::none;
 int Config::BURNIN_DEFAULT_VALUE = 200;
@@ -128,6 +185,8 @@ int Config::NSAMPLES_DEFAULT_VALUE = 800;
 int Config::NUM_LATENT_DEFAULT_VALUE = 96;
 int Config::NUM_THREADS_DEFAULT_VALUE = 0; // as many as you want
 ModelInitTypes Config::INIT_MODEL_DEFAULT_VALUE = ModelInitTypes::zero;
+LatentSamplerTypes Config::LATENT_SAMPLER_DEFAULT_VALUE = LatentSamplerTypes::single;
+bool Config::RESIDUAL_CACHE_DEFAULT_VALUE = false;
 const char* Config::SAVE_PREFIX_DEFAULT_VALUE = "";
 const char* Config::SAVE_EXTENSION_DEFAULT_VALUE = ".ddm";
 int Config::SAVE_FREQ_DEFAULT_VALUE = 0;
@@ -139,11 +198,14 @@ const char* Config::STATUS_DEFAULT_VALUE = "";
 bool Config::ENABLE_BETA_PRECISION_SAMPLING_DEFAULT_VALUE = true;
 double Config::THRESHOLD_DEFAULT_VALUE = 0.0;
 int Config::RANDOM_SEED_DEFAULT_VALUE = 0;
+RandomGeneratorTypes Config::RANDOM_GENERATOR_DEFAULT_VALUE = RandomGeneratorTypes::mt19937;
 
 Config::Config()
 {
    m_action = Config::ACTION_DEFAULT_VALUE;
    m_model_init_type = Config::INIT_MODEL_DEFAULT_VALUE;
+   m_latent_sampler_type = Config::LATENT_SAMPLER_DEFAULT_VALUE;
+   m_residual_cache = Config::RESIDUAL_CACHE_DEFAULT_VALUE;
 
    m_save_prefix = Config::SAVE_PREFIX_DEFAULT_VALUE;
    m_save_extension = Config::SAVE_EXTENSION_DEFAULT_VALUE;
@@ -154,6 +216,7 @@ Config::Config()
 
    m_random_seed_set = false;
    m_random_seed = Config::RANDOM_SEED_DEFAULT_VALUE;
+   m_random_generator_type = Config::RANDOM_GENERATOR_DEFAULT_VALUE;
 
    m_verbose = Config::VERBOSE_DEFAULT_VALUE;
    m_burnin = Config::BURNIN_DEFAULT_VALUE;
@@ -410,7 +473,10 @@ void Config::save(std::string fname) const
    ini.appendItem(GLOBAL_SECTION_TAG, NUM_THREADS_TAG, std::to_string(m_num_threads));
    ini.appendItem(GLOBAL_SECTION_TAG, RANDOM_SEED_SET_TAG, std::to_string(m_random_seed_set));
    ini.appendItem(GLOBAL_SECTION_TAG, RANDOM_SEED_TAG, std::to_string(m_random_seed));
+   ini.appendItem(GLOBAL_SECTION_TAG, RANDOM_GENERATOR_TAG, randomGeneratorTypeToString(m_random_generator_type));
    ini.appendItem(GLOBAL_SECTION_TAG, INIT_MODEL_TAG, modelInitTypeToString(m_model_init_type));
+   ini.appendItem(GLOBAL_SECTION_TAG, LATENT_SAMPLER_TAG, latentSamplerTypeToString(m_latent_sampler_type));
+   ini.appendItem(GLOBAL_SECTION_TAG, RESIDUAL_CACHE_TAG, std::to_string(m_residual_cache));
 
    //probit prior data
    ini.appendComment("binary classification");
@@ -519,7 +585,10 @@ bool Config::restore(std::string fname)
    m_num_threads = reader.getInteger(GLOBAL_SECTION_TAG, NUM_THREADS_TAG, Config::NUM_THREADS_DEFAULT_VALUE);
    m_random_seed_set = reader.getBoolean(GLOBAL_SECTION_TAG, RANDOM_SEED_SET_TAG,  false);
    m_random_seed = reader.getInteger(GLOBAL_SECTION_TAG, RANDOM_SEED_TAG, Config::RANDOM_SEED_DEFAULT_VALUE);
+   m_random_generator_type = stringToRandomGeneratorType(reader.get(GLOBAL_SECTION_TAG, RANDOM_GENERATOR_TAG, randomGeneratorTypeToString(Config::RANDOM_GENERATOR_DEFAULT_VALUE)));
    m_model_init_type = stringToModelInitType(reader.get(GLOBAL_SECTION_TAG, INIT_MODEL_TAG, modelInitTypeToString(Config::INIT_MODEL_DEFAULT_VALUE)));
+   m_latent_sampler_type = stringToLatentSamplerType(reader.get(GLOBAL_SECTION_TAG, LATENT_SAMPLER_TAG, latentSamplerTypeToString(Config::LATENT_SAMPLER_DEFAULT_VALUE)));
+   m_residual_cache = reader.getBoolean(GLOBAL_SECTION_TAG, RESIDUAL_CACHE_TAG, Config::RESIDUAL_CACHE_DEFAULT_VALUE);
 
    //restore probit prior data
    m_classify = reader.getBoolean(GLOBAL_SECTION_TAG, CLASSIFY_TAG,  false);
@@ -550,6 +619,10 @@ bool Config::restoreSaveInfo(std::string fname, std::string& save_prefix, std::s
 std::ostream& Config::info(std::ostream &os, std::string indent) const
 {
    os << indent << "  Iterations: " << getBurnin() << " burnin + " << getNSamples() << " samples\n";
+   os << indent << "  Latent sampler: " << getLatentSamplerTypeAsString() << "\n";
+   if (getResidualCache())
+      os << indent << "  Residual cache: enabled\n";
+   os << indent << "  Random generator: " << getRandomGeneratorTypeAsString() << "\n";
 
    if (getSaveFreq() != 0 || getCheckpointFreq() != 0)
    {
@@ -19,6 +19,12 @@
 #define MODEL_INIT_NAME_RANDOM "random"
 #define MODEL_INIT_NAME_ZERO "zero"
 
+#define LATENT_SAMPLER_NAME_SINGLE "single"
+#define LATENT_SAMPLER_NAME_BATCHED "batched"
+
+#define RANDOM_GENERATOR_NAME_MT19937 "mt19937"
+#define RANDOM_GENERATOR_NAME_PHILOX "philox"
+
 namespace smurff {
 
 enum class PriorTypes
@@ -38,6 +44,18 @@ enum class ModelInitTypes
    zero
 };
 
+enum class LatentSamplerTypes
+{
+   single,
+   batched
+};
+
+enum class RandomGeneratorTypes
+{
+   mt19937,
+   philox
+};
+
 enum class ActionTypes
 {
    train,
@@ -53,6 +71,14 @@ ModelInitTypes stringToModelInitType(std::string name);
 
 std::string modelInitTypeToString(ModelInitTypes type);
 
+LatentSamplerTypes stringToLatentSamplerType(std::string name);
+
+std::string latentSamplerTypeToString(LatentSamplerTypes type);
+
+RandomGeneratorTypes stringToRandomGeneratorType(std::string name);
+
+std::string randomGeneratorTypeToString(RandomGeneratorTypes type);
+
 struct Config
 {
 public:
@@ -64,6 +90,8 @@ public:
    static int NUM_LATENT_DEFAULT_VALUE;
    static int NUM_THREADS_DEFAULT_VALUE;
    static ModelInitTypes INIT_MODEL_DEFAULT_VALUE;
+   static LatentSamplerTypes LATENT_SAMPLER_DEFAULT_VALUE;
+   static bool RESIDUAL_CACHE_DEFAULT_VALUE;
    static const char* SAVE_PREFIX_DEFAULT_VALUE;
    static const char* SAVE_EXTENSION_DEFAULT_VALUE;
    static int SAVE_FREQ_DEFAULT_VALUE;
@@ -75,6 +103,7 @@ public:
    static bool ENABLE_BETA_PRECISION_SAMPLING_DEFAULT_VALUE;
    static double THRESHOLD_DEFAULT_VALUE;
    static int RANDOM_SEED_DEFAULT_VALUE;
+   static RandomGeneratorTypes RANDOM_GENERATOR_DEFAULT_VALUE;
 
 private:
    ActionTypes m_action;
@@ -97,6 +126,12 @@ private:
    //-- init model
    ModelInitTypes m_model_init_type;
 
+   //-- latent sampling engine
+   LatentSamplerTypes m_latent_sampler_type;
+
+   //-- keep residuals of the train data from the sampling pass for the noise update
+   bool m_residual_cache;
+
    //-- save
    mutable std::string m_save_prefix;
    std::string m_save_extension;
@@ -108,6 +143,7 @@ private:
    //-- general
    bool m_random_seed_set;
    int m_random_seed;
+   RandomGeneratorTypes m_random_generator_type;
    int m_verbose;
    int m_burnin;
    int m_nsamples;
@@ -275,6 +311,36 @@ public:
       m_model_init_type = stringToModelInitType(value);
    }
 
+   LatentSamplerTypes getLatentSamplerType() const
+   {
+      return m_latent_sampler_type;
+   }
+
+   void setLatentSamplerType(LatentSamplerTypes value)
+   {
+      m_latent_sampler_type = value;
+   }
+
+   std::string getLatentSamplerTypeAsString() const
+   {
+      return latentSamplerTypeToString(m_latent_sampler_type);
+   }
+
+   void setLatentSamplerType(std::string value)
+   {
+      m_latent_sampler_type = stringToLatentSamplerType(value);
+   }
+
+   bool getResidualCache() const
+   {
+      return m_residual_cache;
+   }
+
+   void setResidualCache(bool value)
+   {
+      m_residual_cache = value;
+   }
+
    std::string getSavePrefix() const;
 
    void setSavePrefix(std::string value)
@@ -349,6 +415,26 @@ public:
       m_random_seed = value;
    }
 
+   RandomGeneratorTypes getRandomGeneratorType() const
+   {
+      return m_random_generator_type;
+   }
+
+   void setRandomGeneratorType(RandomGeneratorTypes value)
+   {
+      m_random_generator_type = value;
+   }
+
+   std::string getRandomGeneratorTypeAsString() const
+   {
+      return randomGeneratorTypeToString(m_random_generator_type);
+   }
+
+   void setRandomGeneratorType(std::string value)
+   {
+      m_random_generator_type = stringToRandomGeneratorType(value);
+   }
+
    int getVerbose() const
    {
       return m_verbose;
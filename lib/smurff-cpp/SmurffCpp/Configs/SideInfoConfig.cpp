@@ -6,6 +6,8 @@
 
 #include "TensorConfig.h"
 
+#include <SmurffCpp/Utils/Error.h>
+
 #define MACAU_PRIOR_CONFIG_PREFIX_TAG "macau_prior_config"
 #define MACAU_PRIOR_CONFIG_ITEM_PREFIX_TAG "macau_prior_config_item"
 
@@ -14,18 +16,101 @@
 #define TOL_TAG "tol"
 #define DIRECT_TAG "direct"
 #define THROW_ON_CHOLESKY_ERROR_TAG "throw_on_cholesky_error"
+#define WARM_START_TAG "warm_start"
+#define PRECONDITIONER_TAG "preconditioner"
+#define DENSE_STORAGE_TAG "dense_storage"
 #define SIDE_INFO_PREFIX "side_info"
 
 using namespace smurff;
 
 double SideInfoConfig::BETA_PRECISION_DEFAULT_VALUE = 10.0;
 double SideInfoConfig::TOL_DEFAULT_VALUE = 1e-6;
+PreconditionerTypes SideInfoConfig::PRECONDITIONER_DEFAULT_VALUE = PreconditionerTypes::none;
+DenseStorageTypes SideInfoConfig::DENSE_STORAGE_DEFAULT_VALUE = DenseStorageTypes::float64;
+
+#define PRECONDITIONER_NAME_NONE "none"
+#define PRECONDITIONER_NAME_JACOBI "jacobi"
+#define PRECONDITIONER_NAME_BLOCKJACOBI "blockjacobi"
+#define PRECONDITIONER_NAME_NYSTROM "nystrom"
+
+PreconditionerTypes smurff::stringToPreconditionerType(std::string name)
+{
+   if(name == PRECONDITIONER_NAME_NONE)
+      return PreconditionerTypes::none;
+   else if(name == PRECONDITIONER_NAME_JACOBI)
+      return PreconditionerTypes::jacobi;
+   else if(name == PRECONDITIONER_NAME_BLOCKJACOBI)
+      return PreconditionerTypes::blockjacobi;
+   else if(name == PRECONDITIONER_NAME_NYSTROM)
+      return PreconditionerTypes::nystrom;
+   else
+   {
+      THROWERROR("Invalid preconditioner type " + name);
+   }
+}
+
+std::string smurff::preconditionerTypeToString(PreconditionerTypes type)
+{
+   switch(type)
+   {
+      case PreconditionerTypes::none:
+         return PRECONDITIONER_NAME_NONE;
+      case PreconditionerTypes::jacobi:
+         return PRECONDITIONER_NAME_JACOBI;
+      case PreconditionerTypes::blockjacobi:
+         return PRECONDITIONER_NAME_BLOCKJACOBI;
+      case PreconditionerTypes::nystrom:
+         return PRECONDITIONER_NAME_NYSTROM;
+      default:
+      {
+         THROWERROR("Invalid preconditioner type");
+      }
+   }
+}
+
+#define DENSE_STORAGE_NAME_FLOAT64 "float64"
+#define DENSE_STORAGE_NAME_FLOAT32 "float32"
+#define DENSE_STORAGE_NAME_UINT8 "uint8"
+
+DenseStorageTypes smurff::stringToDenseStorageType(std::string name)
+{
+   if(name == DENSE_STORAGE_NAME_FLOAT64)
+      return DenseStorageTypes::float64;
+   else if(name == DENSE_STORAGE_NAME_FLOAT32)
+      return DenseStorageTypes::float32;
+   else if(name == DENSE_STORAGE_NAME_UINT8)
+      return DenseStorageTypes::uint8;
+   else
+   {
+      THROWERROR("Invalid dense storage type " + name);
+   }
+}
+
+std::string smurff::denseStorageTypeToString(DenseStorageTypes type)
+{
+   switch(type)
+   {
+      case DenseStorageTypes::float64:
+         return DENSE_STORAGE_NAME_FLOAT64;
+      case DenseStorageTypes::float32:
+         return DENSE_STORAGE_NAME_FLOAT32;
+      case DenseStorageTypes::uint8:
+         return DENSE_STORAGE_NAME_UINT8;
+      default:
+      {
+         THROWERROR("Invalid dense storage type");
+      }
+   }
+}
 
 SideInfoConfig::SideInfoConfig()
 {
    m_tol = SideInfoConfig::TOL_DEFAULT_VALUE;
    m_direct = false;
    m_throw_on_cholesky_error = false;
+   m_warm_start = false;
+   m_preconditioner = SideInfoConfig::PRECONDITIONER_DEFAULT_VALUE;
+   m_dense_storage = SideInfoConfig::DENSE_STORAGE_DEFAULT_VALUE;
 }
 
 void SideInfoConfig::save(INIFile& writer, std::size_t prior_index, std::size_t config_item_index) const
@@ -39,6 +124,9 @@ void SideInfoConfig::save(INIFile& writer, std::size_t prior_index, std::size_t
    writer.appendItem(sectionName, TOL_TAG, std::to_string(m_tol));
    writer.appendItem(sectionName, DIRECT_TAG, std::to_string(m_direct));
    writer.appendItem(sectionName, THROW_ON_CHOLESKY_ERROR_TAG, std::to_string(m_throw_on_cholesky_error));
+   writer.appendItem(sectionName, WARM_START_TAG, std::to_string(m_warm_start));
+   writer.appendItem(sectionName, PRECONDITIONER_TAG, preconditionerTypeToString(m_preconditioner));
+   writer.appendItem(sectionName, DENSE_STORAGE_TAG, denseStorageTypeToString(m_dense_storage));
 
    writer.endSection();
 
@@ -69,6 +157,9 @@ bool SideInfoConfig::restore(const INIFile& reader, std::size_t prior_index, std
    m_tol = reader.getReal(section.str(), TOL_TAG, SideInfoConfig::TOL_DEFAULT_VALUE);
    m_direct = reader.getBoolean(section.str(), DIRECT_TAG, false);
    m_throw_on_cholesky_error = reader.getBoolean(section.str(), THROW_ON_CHOLESKY_ERROR_TAG, false);
+   m_warm_start = reader.getBoolean(section.str(), WARM_START_TAG, false);
+   m_preconditioner = stringToPreconditionerType(reader.get(section.str(), PRECONDITIONER_TAG, preconditionerTypeToString(SideInfoConfig::PRECONDITIONER_DEFAULT_VALUE)));
+   m_dense_storage = stringToDenseStorageType(reader.get(section.str(), DENSE_STORAGE_TAG, denseStorageTypeToString(SideInfoConfig::DENSE_STORAGE_DEFAULT_VALUE)));
 
    std::stringstream ss;
    ss << SIDE_INFO_PREFIX << "_" << prior_index;
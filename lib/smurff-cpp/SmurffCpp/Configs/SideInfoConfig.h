@@ -10,15 +10,45 @@
 
 namespace smurff
 {
+   // preconditioner for the block CG solver (see Utils/Preconditioner.h)
+   enum class PreconditionerTypes
+   {
+      none,
+      jacobi,
+      blockjacobi,
+      nystrom
+   };
+
+   PreconditionerTypes stringToPreconditionerType(std::string name);
+
+   std::string preconditionerTypeToString(PreconditionerTypes type);
+
+   // storage of dense side info (see SideInfo/ReducedDenseSideInfo.h)
+   enum class DenseStorageTypes
+   {
+      float64,
+      float32,
+      uint8
+   };
+
+   DenseStorageTypes stringToDenseStorageType(std::string name);
+
+   std::string denseStorageTypeToString(DenseStorageTypes type);
+
    class SideInfoConfig
    {
    public:
       static double BETA_PRECISION_DEFAULT_VALUE;
       static double TOL_DEFAULT_VALUE;
+      static PreconditionerTypes PRECONDITIONER_DEFAULT_VALUE;
+      static DenseStorageTypes DENSE_STORAGE_DEFAULT_VALUE;
    private:
       double m_tol;
       bool m_direct;
       bool m_throw_on_cholesky_error;
+      bool m_warm_start; // start block CG from the previous solution
+      PreconditionerTypes m_preconditioner;
+      DenseStorageTypes m_dense_storage;
 
       std::shared_ptr<MatrixConfig> m_sideInfo; //side info matrix for macau and macauone prior
 
@@ -66,6 +96,46 @@ namespace smurff
          m_throw_on_cholesky_error = value;
       }
 
+      bool getWarmStart() const
+      {
+         return m_warm_start;
+      }
+
+      void setWarmStart(bool value)
+      {
+         m_warm_start = value;
+      }
+
+      PreconditionerTypes getPreconditioner() const
+      {
+         return m_preconditioner;
+      }
+
+      void setPreconditioner(PreconditionerTypes value)
+      {
+         m_preconditioner = value;
+      }
+
+      void setPreconditioner(std::string value)
+      {
+         m_preconditioner = stringToPreconditionerType(value);
+      }
+
+      DenseStorageTypes getDenseStorage() const
+      {
+         return m_dense_storage;
+      }
+
+      void setDenseStorage(DenseStorageTypes value)
+      {
+         m_dense_storage = value;
+      }
+
+      void setDenseStorage(std::string value)
+      {
+         m_dense_storage = stringToDenseStorageType(value);
+      }
+
    public:
       void save(INIFile& writer, std::size_t prior_index, std::size_t config_item_index) const;
 
@@ -1,6 +1,7 @@
 #include "Data.h"
 #include <SmurffCpp/IO/MatrixIO.h>
 #include <SmurffCpp/Utils/Error.h>
+#include <SmurffCpp/Utils/omp_util.h>
 
 using namespace smurff;
 
@@ -13,6 +14,17 @@ void Data::init()
     init_pre();
 
     init_post();
+
+    // balance the items of each mode over threads, once
+    m_partitions.clear();
+    for (std::uint64_t m = 0; m < nmode(); ++m)
+    {
+       std::vector<std::int64_t> costs(dim(m));
+       for (int d = 0; d < dim(m); ++d)
+          costs[d] = item_cost(m, d);
+
+       m_partitions.push_back(WorkPartition(costs, threads::get_max_threads(), can_split_items()));
+    }
 }
 
 void Data::init_post()
@@ -54,8 +66,51 @@ int Data::view_size(int m, int v) const
     return this->dim(m);
 }
 
+//#### work partition functions ####
+
+std::int64_t Data::item_cost(uint32_t mode, int d) const
+{
+   // all values of the hyperplane
+   return size() / dim(mode);
+}
+
+bool Data::can_split_items() const
+{
+   return false;
+}
+
+const WorkPartition& Data::partition(uint32_t mode) const
+{
+   THROWERROR_ASSERT_MSG(mode < m_partitions.size(), "Data::init() needs to be called before ::partition()");
+   return m_partitions[mode];
+}
+
 //#### noise, precision, mean functions ####
 
+int Data::pnm_rank(uint32_t mode, int d) const
+{
+   return -1;
+}
+
+void Data::getMuLambdaLowRank(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const
+{
+   THROWERROR_NOTIMPL();
+}
+
+void Data::getMuLambdaSplit(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   getMuLambda(model, mode, d, rr, MM);
+}
+
+bool Data::getMuLambdaAll(const SubModel& model, uint32_t mode, Eigen::MatrixXd& RR, Eigen::MatrixXd& MM) const
+{
+   return false;
+}
+
+void Data::update_residuals(const SubModel& model, uint32_t mode, int d)
+{
+}
+
 INoiseModel &Data::noise() const
 {
    THROWERROR_ASSERT(noise_ptr != 0);
@@ -79,6 +134,11 @@ std::ostream& Data::info(std::ostream& os, std::string indent)
    os << indent << "Component-wise variance: " << var_total() << std::endl;
    os << indent << "Noise: ";
    noise().info(os, "");
+   for (std::uint64_t m = 0; m < m_partitions.size(); ++m)
+   {
+      os << indent << "Work partition mode " << m << ": ";
+      m_partitions[m].info(os, "");
+   }
    return os;
 }
 
@@ -7,6 +7,7 @@
 
 #include <SmurffCpp/Noises/INoiseModel.h>
 #include <SmurffCpp/Utils/PVec.hpp>
+#include <SmurffCpp/Utils/WorkPartition.h>
 
 #include <Eigen/Core>
 
@@ -59,6 +60,21 @@ namespace smurff
       virtual int view(int mode, int pos) const;
       virtual int view_size(int m, int v) const;
 
+   //#### work partition functions ####
+
+   private:
+      std::vector<WorkPartition> m_partitions; // per mode, built in init
+
+   public:
+      // cost of getMuLambda for item d of mode, in number of observations
+      virtual std::int64_t item_cost(uint32_t mode, int d) const;
+
+      // true if getMuLambda can split the observations of one item over all
+      // threads, only then the partition takes heavy items out of the chunks
+      virtual bool can_split_items() const;
+
+      const WorkPartition& partition(uint32_t mode) const;
+
    //#### noise, precision, mean functions ####
 
    private:
@@ -69,6 +85,27 @@ namespace smurff
       virtual void update_pnm(const SubModel& model, uint32_t mode) = 0;
       virtual void getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const = 0;
 
+      // getMuLambda for a heavy item of partition(mode), called outside of a
+      // parallel region, data that can_split_items splits its observations over all threads
+      virtual void getMuLambdaSplit(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
+      // rank of the precision contribution MM of item d in mode,
+      // or -1 if MM has no low rank form (for example when VV is cached)
+      virtual int pnm_rank(uint32_t mode, int d) const;
+
+      // same as getMuLambda, but returns MM in low rank form MM = W * W^T,
+      // with W of size num_latent x pnm_rank(mode, d)
+      virtual void getMuLambdaLowRank(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const;
+
+      // getMuLambda for all items of mode at once, for data where this is a
+      // dense product: RR.col(d) is rr of item d and MM is the same for all items.
+      // Returns false if the data or its noise model does not allow it.
+      virtual bool getMuLambdaAll(const SubModel& model, uint32_t mode, Eigen::MatrixXd& RR, Eigen::MatrixXd& MM) const;
+
+      // called after item d of mode has been sampled, data that keeps
+      // a residual cache (see ScarceMatrixData) updates the residuals of d
+      virtual void update_residuals(const SubModel& model, uint32_t mode, int d);
+
    public:
       virtual double sumsq(const SubModel& model) const = 0;
       virtual double var_total() const = 0;
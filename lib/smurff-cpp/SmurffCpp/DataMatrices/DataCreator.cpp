@@ -18,7 +18,7 @@ std::shared_ptr<Data> DataCreator::create(std::shared_ptr<const MatrixConfig> mc
    auto& aux_matrices = m_session->getConfig().getAuxData();
 
    //create creator
-   std::shared_ptr<DataCreatorBase> creatorBase = std::make_shared<DataCreatorBase>();
+   std::shared_ptr<DataCreatorBase> creatorBase = std::make_shared<DataCreatorBase>(m_session->getConfig().getResidualCache());
 
    //create single matrix
    if (aux_matrices.empty())
@@ -49,7 +49,7 @@ std::shared_ptr<Data> DataCreator::create(std::shared_ptr<const TensorConfig> tc
    }
 
    //create creator
-   std::shared_ptr<DataCreatorBase> creatorBase = std::make_shared<DataCreatorBase>();
+   std::shared_ptr<DataCreatorBase> creatorBase = std::make_shared<DataCreatorBase>(m_session->getConfig().getResidualCache());
 
    return tc->create(creatorBase);
 }
@@ -38,7 +38,7 @@ std::shared_ptr<Data> DataCreatorBase::create(std::shared_ptr<const MatrixConfig
       }
       else
       {
-         std::shared_ptr<MatrixData> local_data_ptr(new ScarceMatrixData(Ytrain));
+         std::shared_ptr<MatrixData> local_data_ptr(new ScarceMatrixData(Ytrain, m_residual_cache));
          local_data_ptr->setNoiseModel(noise);
          return local_data_ptr;
       }
@@ -7,8 +7,12 @@
 namespace smurff {
    class DataCreatorBase : public IDataCreator
    {
+   private:
+      bool m_residual_cache;
+
    public:
-      DataCreatorBase()
+      DataCreatorBase(bool residual_cache = false)
+         : m_residual_cache(residual_cache)
       {
       }
 
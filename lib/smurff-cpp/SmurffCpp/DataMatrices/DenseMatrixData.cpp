@@ -1,5 +1,7 @@
 #include "DenseMatrixData.h"
 
+#include <SmurffCpp/Noises/NoiseKernels.h>
+
 using namespace smurff;
 
 DenseMatrixData::DenseMatrixData(Eigen::MatrixXd Y)
@@ -10,22 +12,56 @@ DenseMatrixData::DenseMatrixData(Eigen::MatrixXd Y)
 
 //d is an index of column in U matrix
 void DenseMatrixData::getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaNoise(GaussianNoiseKernel(noise()), model, mode, d, rr, MM);
+      case NoiseTypes::probit:
+         return getMuLambdaNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, d, rr, MM);
+      default:
+         return getMuLambdaNoise(GenericNoiseKernel(noise()), model, mode, d, rr, MM);
+   }
+}
+
+template<class Noise>
+void DenseMatrixData::getMuLambdaNoise(const Noise& ns, const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
 {
     auto &Y = this->Y(mode).col(d);
     auto Vf = *model.CVbegin(mode);
-    auto &ns = noise();
 
     for(int r = 0; r<Y.rows(); ++r) 
     {
         const auto &col = Vf.col(r);
-        PVec<> pos = this->pos(mode, d, r);
-        double noisy_val = ns.sample(model, pos, Y(r));
+        double noisy_val = ns.sample(model, [&]() { return this->pos(mode, d, r); }, Y(r));
         rr.noalias() += col * noisy_val; // rr = rr + (V[m] * noisy_y[d]) 
     }
 
     MM.noalias() += ns.getAlpha() * VV[mode]; // MM = MM + VV[m]
 }
 
+bool DenseMatrixData::getMuLambdaAll(const SubModel& model, uint32_t mode, Eigen::MatrixXd& RR, Eigen::MatrixXd& MM) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         break;
+      default:
+         return false; // the noisy values are sampled per observation
+   }
+
+   const double alpha = noise().getAlpha();
+   auto Vf = *model.CVbegin(mode);
+
+   RR.noalias() = alpha * Vf * this->Y(mode);
+   MM = alpha * VV[mode];
+   return true;
+}
+
 double DenseMatrixData::train_rmse(const SubModel& model) const
 {
    return std::sqrt(sumsq(model) / this->size());
@@ -49,16 +85,16 @@ double DenseMatrixData::var_total() const
 // for the adaptive gaussian noise
 double DenseMatrixData::sumsq(const SubModel& model) const
 {
-   double sumsq = 0.0;
+   thread_vector<double> sumsq(0.0);
 
-   #pragma omp parallel for schedule(guided) reduction(+:sumsq)
-   for (int j = 0; j < this->ncol(); j++) 
+   threads::parallel_for(0, this->ncol(), [this, &model, &sumsq](std::int64_t col)
    {
+      const int j = col;
       for (int i = 0; i < this->nrow(); i++) 
       {
-         sumsq += std::pow(model.predict({i,j}) - this->Y()(i,j), 2);
+         sumsq.local() += std::pow(model.predict({i,j}) - this->Y()(i,j), 2);
       }
-   }
+   });
 
-   return sumsq;
+   return sumsq.combine();
 }
@@ -6,10 +6,18 @@ namespace smurff
 {
    class DenseMatrixData : public FullMatrixData<Eigen::MatrixXd>
    {
+   private:
+      // getMuLambda with noise kernel ns (see Noises/NoiseKernels.h)
+      template<class Noise>
+      void getMuLambdaNoise(const Noise& ns, const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
    public:
       DenseMatrixData(Eigen::MatrixXd Y);
       void getMuLambda(const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const override;
 
+      // with Gaussian noise RR = alpha * V * Y and MM = alpha * VV, one GEMM per mode
+      bool getMuLambdaAll(const SubModel& model, std::uint32_t mode, Eigen::MatrixXd& RR, Eigen::MatrixXd& MM) const override;
+
    public:
       double train_rmse(const SubModel& model) const override;
 
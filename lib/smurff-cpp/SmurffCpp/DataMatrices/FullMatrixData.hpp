@@ -31,12 +31,11 @@ namespace smurff
          smurff::thread_vector<Eigen::MatrixXd> VVs(Eigen::MatrixXd::Zero(nl, nl));
 
          //for each column v of Vf - calculate v * vT and add to VVs
-         #pragma omp parallel for schedule(guided) shared(VVs)
-         for(int n = 0; n < Vf.cols(); n++) 
+         threads::parallel_for(0, Vf.cols(), [&Vf, &VVs](std::int64_t n)
          {
             auto v = Vf.col(n);
             VVs.local() += v * v.transpose(); // VVs = Vvs + v * vT
-         }
+         });
 
          VV[mode] = VVs.combine(); //accumulate sum
       }
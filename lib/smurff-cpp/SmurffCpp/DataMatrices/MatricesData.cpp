@@ -1,5 +1,7 @@
 #include "MatricesData.h"
 
+#include <algorithm>
+
 #include <SmurffCpp/Utils/Error.h>
 
 using namespace smurff;
@@ -120,6 +122,18 @@ void MatricesData::getMuLambda(const SubModel& model, uint32_t mode, int pos, Ei
    THROWERROR_ASSERT(count > 0);
 }
 
+// a heavy item of this data splits its part in every block
+void MatricesData::getMuLambdaSplit(const SubModel& model, uint32_t mode, int pos, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   int count = 0;
+   apply(mode, pos, [&model, mode, pos, &rr, &MM, &count](const Block &b) {
+       b.data()->getMuLambdaSplit(b.submodel(model), mode, pos - b.start(mode), rr, MM);
+       count++;
+   });
+
+   THROWERROR_ASSERT(count > 0);
+}
+
 void MatricesData::update_pnm(const SubModel& model, uint32_t mode)
 {
    for(auto &b : blocks) {
@@ -127,6 +141,28 @@ void MatricesData::update_pnm(const SubModel& model, uint32_t mode)
   }
 }
 
+void MatricesData::update_residuals(const SubModel& model, uint32_t mode, int pos)
+{
+   apply(mode, pos, [&model, mode, pos](const Block &b) {
+       b.data()->update_residuals(b.submodel(model), mode, pos - b.start(mode));
+   });
+}
+
+std::int64_t MatricesData::item_cost(uint32_t mode, int pos) const
+{
+   std::int64_t cost = 0;
+   apply(mode, pos, [mode, pos, &cost](const Block &b) {
+       cost += b.data()->item_cost(mode, pos - b.start(mode));
+   });
+   return cost;
+}
+
+// an item is split only if every block it is in can split its part
+bool MatricesData::can_split_items() const
+{
+   return std::all_of(blocks.begin(), blocks.end(), [](const Block &b) { return b.data()->can_split_items(); });
+}
+
 std::ostream& MatricesData::info(std::ostream& os, std::string indent)
 {
    MatrixData::info(os, indent);
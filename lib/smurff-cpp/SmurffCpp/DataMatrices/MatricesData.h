@@ -25,7 +25,11 @@ namespace smurff
       // update noise and precision/mean
       void update(const SubModel& model) override;
       void getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const override;
+      void getMuLambdaSplit(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const override;
       void update_pnm(const SubModel& model, uint32_t mode) override;
+      void update_residuals(const SubModel& model, uint32_t mode, int pos) override;
+      std::int64_t item_cost(uint32_t mode, int d) const override;
+      bool can_split_items() const override;
 
       //-- print info
       std::ostream& info(std::ostream& os, std::string indent) override;
@@ -43,6 +43,11 @@ namespace smurff
          return Y().sum(); 
       }
 
+      std::int64_t item_cost(uint32_t mode, int d) const override
+      {
+         return Y(mode).col(d).nonZeros();
+      }
+
    public:
       const YType& Y(int mode = 1) const
       {
@@ -4,11 +4,15 @@
 #include <SmurffCpp/ConstVMatrixExprIterator.hpp>
 
 #include <SmurffCpp/Utils/ThreadVector.hpp>
+#include <SmurffCpp/Utils/Distribution.h>
+#include <SmurffCpp/Utils/FixedSize.h>
+#include <SmurffCpp/Noises/NoiseKernels.h>
 
 using namespace smurff;
 
-ScarceMatrixData::ScarceMatrixData(Eigen::SparseMatrix<double> Y)
+ScarceMatrixData::ScarceMatrixData(Eigen::SparseMatrix<double> Y, bool residual_cache)
    : MatrixDataTempl<Eigen::SparseMatrix<double> >(Y)
+   , m_residual_cache(residual_cache)
 {
    name = "ScarceMatrixData [with NAs]";
 }
@@ -43,72 +47,318 @@ std::ostream& ScarceMatrixData::info(std::ostream& os, std::string indent)
     return os;
 }
 
+bool ScarceMatrixData::can_split_items() const
+{
+   return true;
+}
+
 void ScarceMatrixData::getMuLambda(const SubModel& model, std::uint32_t mode, int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaNoise(GaussianNoiseKernel(noise()), model, mode, n, rr, MM);
+      case NoiseTypes::probit:
+         return getMuLambdaNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, n, rr, MM);
+      default:
+         return getMuLambdaNoise(GenericNoiseKernel(noise()), model, mode, n, rr, MM);
+   }
+}
+
+void ScarceMatrixData::getMuLambdaSplit(const SubModel& model, std::uint32_t mode, int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaNoise(GaussianNoiseKernel(noise()), model, mode, n, rr, MM, true);
+      case NoiseTypes::probit:
+         return getMuLambdaNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, n, rr, MM, true);
+      default:
+         return getMuLambdaNoise(GenericNoiseKernel(noise()), model, mode, n, rr, MM, true);
+   }
+}
+
+template<class Noise>
+void ScarceMatrixData::getMuLambdaNoise(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM, bool split) const
 {
    auto &Y = this->Y(mode);
    const int num_latent = model.nlatent();
    const std::int64_t local_nnz = Y.col(n).nonZeros();
-   const std::int64_t total_nnz = Y.nonZeros();
    auto from = Y.outerIndexPtr()[n];
    auto to = Y.outerIndexPtr()[n+1];
 
-   auto getMuLambdaBasic = [&model, this, mode, n](int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) -> void
+   // the noise chunks select their own random streams, the stream of the item
+   // continues afterwards as if no noise had been drawn
+   const Philox4x32 stream = get_rng_stream();
+
+   // heavy items (see WorkPartition) are sampled outside of a parallel region,
+   // split their nonzeros over all threads
+   if (split) 
    {
-       auto &Y = this->Y(mode);
-       auto Vf = *model.CVbegin(mode);
-       auto &ns = noise();
+       // the chunks do not depend on the number of threads, they are made of whole
+       // noise chunks and the partial results are added in chunk order, so the
+       // sum is deterministic
+       const std::int64_t num_noise_chunks = (local_nnz + NOISE_CHUNK_SIZE - 1) / NOISE_CHUNK_SIZE;
+       const int num_chunks = std::max<std::int64_t>(1, std::min<std::int64_t>(SPLIT_MAX_CHUNKS, num_noise_chunks));
+       std::vector<Eigen::VectorXd> rrs(num_chunks, Eigen::VectorXd::Zero(num_latent));
+       std::vector<Eigen::MatrixXd> MMs(num_chunks, Eigen::MatrixXd::Zero(num_latent, num_latent));
 
-       for(int i = from; i < to; ++i)
+       threads::parallel_for(0, num_chunks, [&](std::int64_t c)
        {
-           auto val = Y.valuePtr()[i];
-           auto idx = Y.innerIndexPtr()[i];
-           const auto &col = Vf.col(idx);
-           auto pos = this->pos(mode, n, idx);
-           double noisy_val = ns.sample(model, pos, val);
-           rr.noalias() += col * noisy_val;
-           MM.triangularView<Eigen::Lower>() +=  ns.getAlpha() * col * col.transpose();
-       }
-
-       // make MM complete
-       MM.triangularView<Eigen::Upper>() = MM.transpose();
-    };
+           const std::int64_t chunk_from = from + NOISE_CHUNK_SIZE * (num_noise_chunks * c / num_chunks);
+           const std::int64_t chunk_to = std::min<std::int64_t>(to, from + NOISE_CHUNK_SIZE * (num_noise_chunks * (c + 1) / num_chunks));
+           getMuLambdaBasic(ns, model, mode, n, chunk_from, chunk_to, rrs[c], MMs[c]);
+       });
 
-   
-
-   bool in_parallel = (local_nnz >10000) || ((double)local_nnz > (double)total_nnz / 100.);
-   if (in_parallel) 
-   {
-       const int task_size = ceil(local_nnz / 100.0);
-       thread_vector<Eigen::VectorXd> rrs(Eigen::VectorXd::Zero(num_latent));
-       thread_vector<Eigen::MatrixXd> MMs(Eigen::MatrixXd::Zero(num_latent, num_latent));
-
-       for(int j = from; j < to; j += task_size) 
+       // accumulate 
+       for(int c = 0; c < num_chunks; ++c) 
        {
-           #pragma omp task shared(rrs, MMs)
-           getMuLambdaBasic(j, std::min(j + task_size, to), rrs.local(), MMs.local());
+           MM += MMs[c];
+           rr += rrs[c];
        }
-       #pragma omp taskwait
-       
-       // accumulate 
-       MM += MMs.combine();
-       rr += rrs.combine();
    } 
+   else if (local_nnz < gather_min_nnz(ns) && is_fixed_num_latent(num_latent))
+   {
+      // fewer nonzeros than a noise chunk
+      if (Noise::random)
+         select_rng_stream(mode, n, NOISE_RNG_STREAM);
+
+      switch(num_latent)
+      {
+         case 8:  getMuLambdaFixed<8>(ns, model, mode, n, from, to, rr, MM); break;
+         case 16: getMuLambdaFixed<16>(ns, model, mode, n, from, to, rr, MM); break;
+         case 32: getMuLambdaFixed<32>(ns, model, mode, n, from, to, rr, MM); break;
+      }
+   }
    else 
    {
       Eigen::VectorXd my_rr = Eigen::VectorXd::Zero(num_latent);
       Eigen::MatrixXd my_MM = Eigen::MatrixXd::Zero(num_latent, num_latent);
 
-      getMuLambdaBasic(from, to, my_rr, my_MM);
+      getMuLambdaBasic(ns, model, mode, n, from, to, my_rr, my_MM);
 
       // add to global
       rr += my_rr;
       MM += my_MM;
    }
+
+   if (Noise::random)
+      set_rng_stream(stream);
+}
+
+template<class Noise>
+void ScarceMatrixData::getMuLambdaBasic(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   auto &Y = this->Y(mode);
+   auto Vf = *model.CVbegin(mode);
+   const int first = Y.outerIndexPtr()[n];
+
+   for (int start = from; start < to; )
+   {
+      // kernels that draw go through the noise chunks one at a time
+      int end = to;
+      if (Noise::random)
+      {
+         const int k = (start - first) / NOISE_CHUNK_SIZE;
+         end = std::min(to, first + (k + 1) * NOISE_CHUNK_SIZE);
+         select_rng_stream(mode, n, NOISE_RNG_STREAM + k);
+      }
+
+      if (end - start >= gather_min_nnz(ns))
+      {
+         getMuLambdaGather(ns, model, mode, n, start, end, rr, MM);
+      }
+      else
+      {
+         for(int i = start; i < end; ++i)
+         {
+            auto val = Y.valuePtr()[i];
+            auto idx = Y.innerIndexPtr()[i];
+            const auto &col = Vf.col(idx);
+            double noisy_val = ns.sample(model, [&]() { return this->pos(mode, n, idx); }, val);
+            rr.noalias() += col * noisy_val;
+            MM.triangularView<Eigen::Lower>() +=  ns.getAlpha() * col * col.transpose();
+         }
+      }
+
+      start = end;
+   }
+
+   // make MM complete
+   MM.triangularView<Eigen::Upper>() = MM.transpose();
+}
+
+// Gathers the V columns of a block of nonzeros into a contiguous K x T tile and
+// the noisy values into y, so that
+//    rr += tile * y                            (one GEMV)
+//    MM += alpha * tile * tile^T               (one SYRK, lower triangle)
+// instead of one rank-1 update with random access into V per nonzero.
+template<class Noise>
+void ScarceMatrixData::getMuLambdaGather(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   auto &Y = this->Y(mode);
+   auto Vf = *model.CVbegin(mode);
+   const double alpha = ns.getAlpha();
+
+   Eigen::MatrixXd tile(model.nlatent(), std::min(to - from, (int)GATHER_TILE_SIZE));
+   Eigen::VectorXd y(tile.cols());
+
+   for(int start = from; start < to; start += tile.cols())
+   {
+      const int count = std::min(to - start, (int)tile.cols());
+      for(int j = 0; j < count; ++j)
+      {
+         const int i = start + j;
+         auto idx = Y.innerIndexPtr()[i];
+         tile.col(j) = Vf.col(idx);
+         y(j) = ns.sample(model, [&]() { return this->pos(mode, n, idx); }, Y.valuePtr()[i]);
+      }
+
+      rr.noalias() += tile.leftCols(count) * y.head(count);
+      MM.selfadjointView<Eigen::Lower>().rankUpdate(tile.leftCols(count), alpha);
+   }
+}
+
+void ScarceMatrixData::getMuLambdaGather(const ProbitNoiseKernel& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   auto &Y = this->Y(mode);
+   auto Vf = *model.CVbegin(mode);
+   const auto &u = model.U(mode).col(n);
+   const double alpha = ns.getAlpha();
+
+   Eigen::MatrixXd tile(model.nlatent(), std::min(to - from, (int)GATHER_TILE_SIZE));
+   Eigen::VectorXd val(tile.cols()), pred(tile.cols()), y(tile.cols());
+
+   for(int start = from; start < to; start += tile.cols())
+   {
+      const int count = std::min(to - start, (int)tile.cols());
+      for(int j = 0; j < count; ++j)
+      {
+         const int i = start + j;
+         tile.col(j) = Vf.col(Y.innerIndexPtr()[i]);
+         val(j) = Y.valuePtr()[i];
+      }
+
+      // predictions of all nonzeros: u^T * V(:, idx)
+      pred.head(count).noalias() = tile.leftCols(count).transpose() * u;
+      ns.sample(count, pred.data(), val.data(), y.data());
+
+      rr.noalias() += tile.leftCols(count) * y.head(count);
+      MM.selfadjointView<Eigen::Lower>().rankUpdate(tile.leftCols(count), alpha);
+   }
+}
+
+template<int K, class Noise>
+void ScarceMatrixData::getMuLambdaFixed(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   auto &Y = this->Y(mode);
+   auto Vf = *model.CVbegin(mode);
+
+   Eigen::Matrix<double, K, 1> my_rr = Eigen::Matrix<double, K, 1>::Zero();
+   Eigen::Matrix<double, K, K> my_MM = Eigen::Matrix<double, K, K>::Zero();
+
+   for(int i = from; i < to; ++i)
+   {
+      auto val = Y.valuePtr()[i];
+      auto idx = Y.innerIndexPtr()[i];
+      const Eigen::Matrix<double, K, 1> col = Vf.col(idx);
+      double noisy_val = ns.sample(model, [&]() { return this->pos(mode, n, idx); }, val);
+      my_rr.noalias() += col * noisy_val;
+      // full rank-1 update, at fixed size this vectorizes better than the lower triangle only
+      my_MM.noalias() += (ns.getAlpha() * col) * col.transpose();
+   }
+
+   // add to global
+   rr += my_rr;
+   MM += my_MM;
+}
+
+int ScarceMatrixData::pnm_rank(std::uint32_t mode, int d) const
+{
+   // one rank-1 term per nonzero
+   return this->Y(mode).col(d).nonZeros();
+}
+
+void ScarceMatrixData::getMuLambdaLowRank(const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaLowRankNoise(GaussianNoiseKernel(noise()), model, mode, d, rr, W);
+      case NoiseTypes::probit:
+         return getMuLambdaLowRankNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, d, rr, W);
+      default:
+         return getMuLambdaLowRankNoise(GenericNoiseKernel(noise()), model, mode, d, rr, W);
+   }
+}
+
+template<class Noise>
+void ScarceMatrixData::getMuLambdaLowRankNoise(const Noise& ns, const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const
+{
+   auto &Y = this->Y(mode);
+   auto Vf = *model.CVbegin(mode);
+   const double sqrt_alpha = std::sqrt(ns.getAlpha());
+   const int from = Y.outerIndexPtr()[d];
+   const int to = Y.outerIndexPtr()[d + 1];
+
+   W.resize(model.nlatent(), to - from);
+
+   // same noise streams as getMuLambda
+   const Philox4x32 stream = get_rng_stream();
+
+   for(int i = from; i < to; ++i)
+   {
+      if (Noise::random && (i - from) % NOISE_CHUNK_SIZE == 0)
+         select_rng_stream(mode, d, NOISE_RNG_STREAM + (i - from) / NOISE_CHUNK_SIZE);
+
+      auto idx = Y.innerIndexPtr()[i];
+      const auto &col = Vf.col(idx);
+      double noisy_val = ns.sample(model, [&]() { return this->pos(mode, d, idx); }, Y.valuePtr()[i]);
+      rr.noalias() += col * noisy_val;
+      W.col(i - from) = sqrt_alpha * col;
+   }
+
+   if (Noise::random)
+      set_rng_stream(stream);
 }
 
 void ScarceMatrixData::update_pnm(const SubModel &, std::uint32_t mode)
 {
    //can not cache VV because of scarceness
+
+   // residuals are only final once the last mode has been sampled
+   m_residuals_valid = m_residual_cache && mode == nmode() - 1;
+   if (m_residuals_valid)
+      m_residuals.resize(Y().nonZeros());
+}
+
+void ScarceMatrixData::update_residuals(const SubModel& model, std::uint32_t mode, int d)
+{
+   if (!m_residuals_valid || mode != nmode() - 1)
+      return;
+
+   const auto &Y = this->Y(mode);
+   auto Vf = *model.CVbegin(mode);
+   const auto &u = model.U(mode).col(d);
+
+   auto body = [this, &Y, &Vf, &u](std::int64_t from, std::int64_t to)
+   {
+      for (std::int64_t i = from; i < to; i++)
+         m_residuals[i] = static_cast<float>(u.dot(Vf.col(Y.innerIndexPtr()[i])) - Y.valuePtr()[i]);
+   };
+
+   const int from = Y.outerIndexPtr()[d];
+   const int to = Y.outerIndexPtr()[d + 1];
+   if (to - from >= RESIDUAL_PARALLEL_NNZ)
+      threads::parallel_for_blocks(from, to, body);
+   else
+      body(from, to);
 }
 
 std::uint64_t ScarceMatrixData::nna() const
@@ -142,16 +392,28 @@ double ScarceMatrixData::var_total() const
 
 double ScarceMatrixData::sumsq(const SubModel& model) const
 {
-   double sumsq = 0.0;
+   thread_vector<double> sumsq(0.0);
 
-   #pragma omp parallel for schedule(guided) reduction(+:sumsq)
-   for (int j = 0; j < Y().outerSize(); j++) 
+   if (m_residuals_valid)
+   {
+      threads::parallel_for_blocks(0, m_residuals.size(), [this, &sumsq](std::int64_t from, std::int64_t to)
+      {
+         double s = 0.0;
+         for (std::int64_t i = from; i < to; i++)
+            s += static_cast<double>(m_residuals[i]) * m_residuals[i];
+         sumsq.local() += s;
+      });
+
+      return sumsq.combine();
+   }
+
+   threads::parallel_for(0, Y().outerSize(), [this, &model, &sumsq](std::int64_t j)
    {
       for (Eigen::SparseMatrix<double>::InnerIterator it(Y(), j); it; ++it) 
       {
-         sumsq += std::pow(model.predict({static_cast<int>(it.row()), static_cast<int>(it.col())})- it.value(), 2);
+         sumsq.local() += std::pow(model.predict({static_cast<int>(it.row()), static_cast<int>(it.col())})- it.value(), 2);
       }
-   }
+   });
 
-   return sumsq;
+   return sumsq.combine();
 }
@@ -1,16 +1,74 @@
 #pragma once
 
+#include <vector>
+
 #include "MatrixDataTempl.hpp"
 
 namespace smurff
 {
+   class ProbitNoiseKernel;
+
    class ScarceMatrixData : public MatrixDataTempl<Eigen::SparseMatrix<double> >
    {
    private:
       int num_empty[2] = {0,0};
 
+      // columns with at least this many nonzeros gather their V columns into
+      // tiles of at most GATHER_TILE_SIZE and use GEMV + SYRK (see getMuLambdaGather)
+      static const int GATHER_MIN_NNZ = 32;
+      static const int GATHER_TILE_SIZE = 256;
+
+      // heavy columns are split in at most this many chunks of nonzeros
+      static const int SPLIT_MAX_CHUNKS = 64;
+
+      // the noise of nonzeros k * NOISE_CHUNK_SIZE .. (k + 1) * NOISE_CHUNK_SIZE of a column
+      // is drawn from random stream NOISE_RNG_STREAM + k of the column, whether the
+      // column is split or not, split columns are cut at multiples of NOISE_CHUNK_SIZE
+      static const int NOISE_CHUNK_SIZE = 256;
+      static const int NOISE_RNG_STREAM = 0x100;
+
+      // optional cache of the residuals (prediction - value) of all nonzeros of Y(), in
+      // storage order. update_residuals fills it while the last mode is sampled, so
+      // sumsq and train_rmse do not need to recompute the predictions afterwards
+      bool m_residual_cache;
+      bool m_residuals_valid = false; // from the start of sampling the last mode until the next update_pnm
+      std::vector<float> m_residuals;
+
+      // columns with at least this many nonzeros update their residuals in parallel
+      static const int RESIDUAL_PARALLEL_NNZ = 4096;
+
+      // getMuLambda and getMuLambdaLowRank with noise kernel ns (see Noises/NoiseKernels.h),
+      // with split the nonzeros of n are spread over all threads
+      template<class Noise>
+      void getMuLambdaNoise(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM, bool split = false) const;
+      template<class Noise>
+      void getMuLambdaLowRankNoise(const Noise& ns, const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const;
+
+      // adds rr and the lower triangle of MM for nonzeros [from, to) of column n,
+      // from is the first nonzero of n or of one of its noise chunks
+      template<class Noise>
+      void getMuLambdaBasic(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
+      // same as getMuLambdaBasic, with the V columns gathered in tiles
+      template<class Noise>
+      void getMuLambdaGather(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
+      // probit noise needs the prediction of every nonzero: computes them for a whole
+      // tile in one GEMV and draws the truncated normals of the tile together
+      void getMuLambdaGather(const ProbitNoiseKernel& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
+      // columns with at least this many nonzeros take the gather path,
+      // with probit noise all columns do
+      template<class Noise>
+      static int gather_min_nnz(const Noise&) { return GATHER_MIN_NNZ; }
+      static int gather_min_nnz(const ProbitNoiseKernel&) { return 1; }
+
+      // getMuLambda over nonzeros [from, to) of column n with compile-time num_latent (see Utils/FixedSize.h)
+      template<int K, class Noise>
+      void getMuLambdaFixed(const Noise& ns, const SubModel& model, std::uint32_t mode, int n, int from, int to, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
    public:
-      ScarceMatrixData(Eigen::SparseMatrix<double> Y);
+      ScarceMatrixData(Eigen::SparseMatrix<double> Y, bool residual_cache = false);
 
    public:
       void init_pre() override;
@@ -20,7 +78,14 @@ namespace smurff
       std::ostream& info(std::ostream& os, std::string indent) override;
 
       void getMuLambda(const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const override;
+      void getMuLambdaSplit(const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const override;
       void update_pnm(const SubModel& model, std::uint32_t mode) override;
+      void update_residuals(const SubModel& model, std::uint32_t mode, int d) override;
+
+      bool can_split_items() const override;
+
+      int pnm_rank(std::uint32_t mode, int d) const override;
+      void getMuLambdaLowRank(const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const override;
 
       std::uint64_t nna() const override;
 
@@ -1,5 +1,9 @@
 #include "SparseMatrixData.h"
 
+#include <algorithm>
+
+#include <SmurffCpp/Noises/NoiseKernels.h>
+
 using namespace smurff;
 
 SparseMatrixData::SparseMatrixData(Eigen::SparseMatrix<double> Y)
@@ -9,16 +13,30 @@ SparseMatrixData::SparseMatrixData(Eigen::SparseMatrix<double> Y)
 }
 
 void SparseMatrixData::getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaNoise(GaussianNoiseKernel(noise()), model, mode, d, rr, MM);
+      case NoiseTypes::probit:
+         return getMuLambdaNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, d, rr, MM);
+      default:
+         return getMuLambdaNoise(GenericNoiseKernel(noise()), model, mode, d, rr, MM);
+   }
+}
+
+template<class Noise>
+void SparseMatrixData::getMuLambdaNoise(const Noise& ns, const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
 {
     const auto& Y = this->Y(mode);
     auto Vf = *model.CVbegin(mode);
-    auto &ns = noise();
 
     for (Eigen::SparseMatrix<double>::InnerIterator it(Y, d); it; ++it) 
     {
         const auto &col = Vf.col(it.row());
-        auto p = pos(mode, d, it.row());
-        double noisy_val = ns.sample(model, p, it.value());
+        double noisy_val = ns.sample(model, [&]() { return this->pos(mode, d, it.row()); }, it.value());
         rr.noalias() += col * noisy_val; // rr = rr + (V[m] * y[d]) * alpha
     }
 
@@ -62,24 +80,28 @@ double SparseMatrixData::var_total() const
 
 double SparseMatrixData::sumsq(const SubModel& model) const
 {
-   double sumsq = 0.0;
-   
-   #pragma omp parallel for schedule(guided) reduction(+:sumsq)
-   for(int c = 0; c < Y().cols(); ++c)
+   // sum over all cells of (U^T V)^2 = trace(UU^T VV^T), which only needs the two K x K Gram
+   // matrices, then correct the stored nonzeros from pred^2 to (pred - y)^2
+   const auto U = model.U(0);
+   const auto V = model.U(1);
+
+   const Eigen::MatrixXd UU = U * U.transpose();
+   const Eigen::MatrixXd VV = V * V.transpose();
+   const double sumsq_pred = UU.cwiseProduct(VV).sum();
+
+   thread_vector<double> sumsqs(0.0);
+
+   threads::parallel_for(0, Y().cols(), [this, &U, &V, &sumsqs](std::int64_t col)
    {
-      int r = 0;
+      const int c = col;
+      const auto &v = V.col(c);
+      double &sumsq = sumsqs.local();
       for (Eigen::SparseMatrix<double>::InnerIterator it(Y(), c); it; ++it)
       {
-         for(; r < it.row(); r++) //handle implicit zeroes
-            sumsq += std::pow(model.predict({r, c}), 2);
-
-         sumsq += std::pow(model.predict({r, c}) - it.value(), 2);
-         r++;
+         const double pred = U.col(it.row()).dot(v);
+         sumsq += it.value() * (it.value() - 2.0 * pred); // (pred - y)^2 - pred^2
       }
+   });
 
-      for(; r < Y().rows(); r++) //handle implicit zeroes
-         sumsq += std::pow(model.predict({r, c}), 2);
-   }
-
-   return sumsq;
+   return std::max(sumsq_pred + sumsqs.combine(), 0.0);
 }
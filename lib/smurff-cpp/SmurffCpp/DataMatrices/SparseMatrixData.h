@@ -6,6 +6,11 @@ namespace smurff
 {
    class SparseMatrixData : public FullMatrixData<Eigen::SparseMatrix<double> >
    {
+   private:
+      // getMuLambda with noise kernel ns (see Noises/NoiseKernels.h)
+      template<class Noise>
+      void getMuLambdaNoise(const Noise& ns, const SubModel& model, std::uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
    public:
       SparseMatrixData(Eigen::SparseMatrix<double> Y);
 
@@ -5,6 +5,8 @@
 #include <iomanip>
 
 #include <SmurffCpp/ConstVMatrixExprIterator.hpp>
+#include <SmurffCpp/Utils/ThreadVector.hpp>
+#include <SmurffCpp/Noises/NoiseKernels.h>
 
 using namespace smurff;
 
@@ -101,6 +103,22 @@ double TensorData::train_rmse(const SubModel& model) const
 //it does j multiplications
 //where each multiplication is a cwiseProduct of columns from each V matrix
 void TensorData::getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaNoise(GaussianNoiseKernel(noise()), model, mode, d, rr, MM);
+      case NoiseTypes::probit:
+         return getMuLambdaNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, d, rr, MM);
+      default:
+         return getMuLambdaNoise(GenericNoiseKernel(noise()), model, mode, d, rr, MM);
+   }
+}
+
+template<class Noise>
+void TensorData::getMuLambdaNoise(const Noise& ns, const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
 {
    std::shared_ptr<SparseMode> sview = Y(mode); //get tensor rotation for mode
    
@@ -114,16 +132,70 @@ void TensorData::getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen:
          ++V; //inc iterator prior to access since we are starting from m = 1
          col.noalias() = col.cwiseProduct((*V).col(sview->getIndices()(j, m))); //multiply by m'th column from V
       }
-      MM.triangularView<Eigen::Lower>() += noise().getAlpha() * col * col.transpose(); // MM = MM + (col * colT) * alpha (where col = product of columns in each V)
+      MM.triangularView<Eigen::Lower>() += ns.getAlpha() * col * col.transpose(); // MM = MM + (col * colT) * alpha (where col = product of columns in each V)
       
-      auto pos = sview->pos(d, j);
-      double noisy_val = noise().sample(model, pos, sview->getValues()[j]);
+      double noisy_val = ns.sample(model, [&]() { return sview->pos(d, j); }, sview->getValues()[j]);
       rr.noalias() += col * noisy_val; // rr = rr + (col * value) * alpha (where value = j'th value of Y)
    }
 
    MM.triangularView<Eigen::Upper>() = MM.transpose();
 }
 
+std::int64_t TensorData::item_cost(uint32_t mode, int d) const
+{
+   std::shared_ptr<SparseMode> sview = Y(mode);
+   return sview->endPlane(d) - sview->beginPlane(d);
+}
+
+int TensorData::pnm_rank(uint32_t mode, int d) const
+{
+   // one rank-1 term per item in the hyperplane
+   std::shared_ptr<SparseMode> sview = Y(mode);
+   return sview->endPlane(d) - sview->beginPlane(d);
+}
+
+//same columns as getMuLambda, stored as columns of W instead of accumulated in MM
+void TensorData::getMuLambdaLowRank(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const
+{
+   switch(noise().getNoiseType())
+   {
+      case NoiseTypes::fixed:
+      case NoiseTypes::sampled:
+      case NoiseTypes::adaptive:
+         return getMuLambdaLowRankNoise(GaussianNoiseKernel(noise()), model, mode, d, rr, W);
+      case NoiseTypes::probit:
+         return getMuLambdaLowRankNoise(ProbitNoiseKernel(static_cast<const ProbitNoise&>(noise())), model, mode, d, rr, W);
+      default:
+         return getMuLambdaLowRankNoise(GenericNoiseKernel(noise()), model, mode, d, rr, W);
+   }
+}
+
+template<class Noise>
+void TensorData::getMuLambdaLowRankNoise(const Noise& ns, const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const
+{
+   std::shared_ptr<SparseMode> sview = Y(mode); //get tensor rotation for mode
+   const double sqrt_alpha = std::sqrt(ns.getAlpha());
+   const std::uint64_t begin = sview->beginPlane(d);
+
+   W.resize(model.nlatent(), sview->endPlane(d) - begin);
+
+   auto V0 = model.CVbegin(mode); //get first V matrix
+   for (std::uint64_t j = begin; j < sview->endPlane(d); j++) //go through hyperplane in tensor rotation
+   {
+      Eigen::VectorXd col = (*V0).col(sview->getIndices()(j, 0)); //create a copy of m'th column from V (m = 0)
+      auto V = model.CVbegin(mode); //get V matrices for mode
+      for (std::uint64_t m = 1; m < sview->getNCoords(); m++) //go through each coordinate of value
+      {
+         ++V; //inc iterator prior to access since we are starting from m = 1
+         col.noalias() = col.cwiseProduct((*V).col(sview->getIndices()(j, m))); //multiply by m'th column from V
+      }
+      W.col(j - begin) = sqrt_alpha * col;
+
+      double noisy_val = ns.sample(model, [&]() { return sview->pos(d, j); }, sview->getValues()[j]);
+      rr.noalias() += col * noisy_val;
+   }
+}
+
 void TensorData::update_pnm(const SubModel& model, uint32_t mode)
 {
    //do not need to cache VV here
@@ -131,22 +203,21 @@ void TensorData::update_pnm(const SubModel& model, uint32_t mode)
 
 double TensorData::sumsq(const SubModel& model) const
 {
-   double sumsq = 0.0;
+   thread_vector<double> sumsq(0.0);
 
    std::shared_ptr<SparseMode> sview = Y(0);
 
-   #pragma omp parallel for schedule(guided) reduction(+:sumsq)
-   for(std::uint64_t h = 0; h < sview->getNPlanes(); h++) //go through each hyperplane
+   threads::parallel_for(0, sview->getNPlanes(), [&sview, &model, &sumsq](std::int64_t h) //go through each hyperplane
    {
       for(std::uint64_t n = 0; n < sview->nItemsOnPlane(h); n++) //go through each item in the hyperplane
       {
          auto item = sview->item(h, n);
          double pred = model.predict(item.first);
-         sumsq += std::pow(pred - item.second, 2);
+         sumsq.local() += std::pow(pred - item.second, 2);
       }
-   }
+   });
 
-   return sumsq;
+   return sumsq.combine();
 }
 
 double TensorData::var_total() const
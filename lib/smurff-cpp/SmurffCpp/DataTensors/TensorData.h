@@ -22,6 +22,12 @@ private:
    std::uint64_t m_nnz;
    std::shared_ptr<std::vector<std::shared_ptr<SparseMode> > > m_Y; // this is a vector of tensor rotations
 
+   // getMuLambda and getMuLambdaLowRank with noise kernel ns (see Noises/NoiseKernels.h)
+   template<class Noise>
+   void getMuLambdaNoise(const Noise& ns, const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+   template<class Noise>
+   void getMuLambdaLowRankNoise(const Noise& ns, const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const;
+
 public:
    TensorData(const smurff::TensorConfig& tc);
 
@@ -44,6 +50,11 @@ public:
    void getMuLambda(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const override;
    void update_pnm(const SubModel& model, uint32_t mode) override;
 
+   std::int64_t item_cost(uint32_t mode, int d) const override;
+
+   int pnm_rank(uint32_t mode, int d) const override;
+   void getMuLambdaLowRank(const SubModel& model, uint32_t mode, int d, Eigen::VectorXd& rr, Eigen::MatrixXd& W) const override;
+
 public:
    double sumsq(const SubModel& model) const override;
    double var_total() const override;
@@ -22,6 +22,7 @@
 
 #include <SmurffCpp/Utils/Error.h>
 #include <SmurffCpp/Utils/StepFile.h>
+#include <SmurffCpp/Utils/FixedSize.h>
 
 #include <SmurffCpp/IO/GenericIO.h>
 
@@ -78,7 +79,14 @@ double Model::predict(const PVec<> &pos) const
 {
    if (nmodes() == 2)
    {
-      return col(0, pos[0]).dot(col(1, pos[1]));
+      switch(m_num_latent)
+      {
+         case 8:  return col(0, pos[0]).head<8>().dot(col(1, pos[1]).head<8>());
+         case 16: return col(0, pos[0]).head<16>().dot(col(1, pos[1]).head<16>());
+         case 32: return col(0, pos[0]).head<32>().dot(col(1, pos[1]).head<32>());
+         case 64: return col(0, pos[0]).head<64>().dot(col(1, pos[1]).head<64>());
+         default: return col(0, pos[0]).dot(col(1, pos[1]));
+      }
    }
 
    auto &P = Pcache.local();
@@ -184,6 +192,7 @@ void Model::restore(std::shared_ptr<const StepFile> sf)
 std::ostream& Model::info(std::ostream &os, std::string indent) const
 {
    os << indent << "Num-latents: " << m_num_latent << std::endl;
+   os << indent << "Kernels: " << (is_fixed_num_latent(m_num_latent) ? "fixed-size" : "dynamic-size") << std::endl;
    return os;
 }
 
@@ -54,6 +54,11 @@ std::string AdaptiveGaussianNoise::getStatus()
    return ss.str();
 }
 
+NoiseTypes AdaptiveGaussianNoise::getNoiseType() const
+{
+   return NoiseTypes::adaptive;
+}
+
 void AdaptiveGaussianNoise::setSNInit(double a)
 {
    sn_init = a;
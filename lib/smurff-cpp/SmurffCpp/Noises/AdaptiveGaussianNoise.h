@@ -31,6 +31,7 @@ namespace smurff {
 
       std::ostream &info(std::ostream &os, std::string indent) override;
       std::string getStatus() override;
+      NoiseTypes getNoiseType() const override;
 
       void setSNInit(double a);
       void setSNMax(double a);
@@ -21,6 +21,11 @@ std::string FixedGaussianNoise::getStatus()
    return std::string("Fixed: ") + std::to_string(alpha);
 }
 
+NoiseTypes FixedGaussianNoise::getNoiseType() const
+{
+   return NoiseTypes::fixed;
+}
+
 void FixedGaussianNoise::setPrecision(double a)
 {
    alpha = a;
@@ -20,6 +20,7 @@ namespace smurff {
    public:
       std::ostream& info(std::ostream& os, std::string indent)  override;
       std::string getStatus() override;
+      NoiseTypes getNoiseType() const override;
 
       void setPrecision(double a);
    };
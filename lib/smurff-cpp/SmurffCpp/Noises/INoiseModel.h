@@ -6,6 +6,7 @@
 #include <Eigen/Core>
 
 #include <SmurffCpp/Utils/PVec.hpp>
+#include <SmurffCpp/Configs/NoiseConfig.h>
 
 namespace smurff {
 
@@ -39,6 +40,9 @@ namespace smurff {
       virtual std::ostream &info(std::ostream &os, std::string indent)   = 0;
       virtual std::string getStatus()  = 0;
 
+      // selects the kernel of getMuLambda, see NoiseKernels.h
+      virtual NoiseTypes getNoiseType() const = 0;
+
       virtual double getAlpha() const;
       virtual double sample(const SubModel& model, const PVec<> &pos, double val);
    };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+
+#include <SmurffCpp/Model.h>
+#include <SmurffCpp/Noises/INoiseModel.h>
+#include <SmurffCpp/Noises/ProbitNoise.h>
+#include <SmurffCpp/Utils/TruncNorm.h>
+
+namespace smurff {
+
+   // Non-virtual versions of INoiseModel::getAlpha and INoiseModel::sample for
+   // the inner loops of getMuLambda. The data classes pick the kernel once per item
+   // with getNoiseType() and run their loop templated on the kernel type.
+   //
+   // sample() takes the position of the observation as a function returning a PVec<>,
+   // only kernels that need it (probit) build the position and call model.predict
+   //
+   // random is true when sample() draws random numbers
+
+   // fixed, sampled and adaptive Gaussian noise: alpha * val
+   class GaussianNoiseKernel
+   {
+      double alpha;
+
+   public:
+      static const bool random = false;
+
+      GaussianNoiseKernel(const INoiseModel &ns) : alpha(ns.getAlpha()) {}
+
+      double getAlpha() const { return alpha; }
+
+      template<typename Pos>
+      double sample(const SubModel &, const Pos &, double val) const
+      {
+         return alpha * val;
+      }
+   };
+
+   class ProbitNoiseKernel
+   {
+      double threshold;
+
+   public:
+      static const bool random = true;
+
+      ProbitNoiseKernel(const ProbitNoise &ns) : threshold(ns.getThreshold()) {}
+
+      double getAlpha() const { return 1.0; }
+
+      template<typename Pos>
+      double sample(const SubModel &model, const Pos &pos, double val) const
+      {
+         double sign = (val < threshold) ? -1. : 1.;
+         double pred = model.predict(pos());
+         return sign * rand_truncnorm(pred * sign, 1.0, 0.0);
+      }
+
+      // out[i] = sample with prediction pred[i] for val[i], i = 0 .. n-1,
+      // the truncated normals are drawn together
+      void sample(int n, const double *pred, const double *val, double *out) const
+      {
+         const int B = 256;
+         double low_cut[B], xbar[B];
+
+         for (int start = 0; start < n; start += B)
+         {
+            const int m = std::min(B, n - start);
+
+            // rand_truncnorm(mean, 1.0, 0.0) = rand_truncnorm(-mean) + mean
+            for (int i = 0; i < m; i++)
+            {
+               const double sign = (val[start + i] < threshold) ? -1. : 1.;
+               low_cut[i] = -pred[start + i] * sign;
+            }
+
+            rand_truncnorm(m, low_cut, xbar);
+
+            for (int i = 0; i < m; i++)
+            {
+               const double sign = (val[start + i] < threshold) ? -1. : 1.;
+               out[start + i] = sign * (xbar[i] + pred[start + i] * sign);
+            }
+         }
+      }
+   };
+
+   // any other noise model, through the virtual functions
+   class GenericNoiseKernel
+   {
+      INoiseModel &ns;
+
+   public:
+      static const bool random = true;
+
+      GenericNoiseKernel(INoiseModel &n) : ns(n) {}
+
+      double getAlpha() const { return ns.getAlpha(); }
+
+      template<typename Pos>
+      double sample(const SubModel &model, const Pos &pos, double val) const
+      {
+         return ns.sample(model, pos(), val);
+      }
+   };
+}
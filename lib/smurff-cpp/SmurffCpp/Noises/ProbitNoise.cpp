@@ -2,7 +2,7 @@
 
 #include <SmurffCpp/Utils/Error.h>
 
-#include <SmurffCpp/Utils/TruncNorm.h>
+#include <SmurffCpp/Noises/NoiseKernels.h>
 #include <SmurffCpp/Model.h>
 
 using namespace smurff;
@@ -22,9 +22,12 @@ ProbitNoise::ProbitNoise(double t)
 
 double ProbitNoise::sample(const SubModel& model, const PVec<> &pos, double val)
 {
-    double sign = (val < threshold) ? -1. : 1.;
-    double pred = model.predict(pos);
-    return sign * rand_truncnorm(pred * sign, 1.0, 0.0);
+    return ProbitNoiseKernel(*this).sample(model, [&pos]() { return pos; }, val);
+}
+
+double ProbitNoise::getThreshold() const
+{
+    return threshold;
 }
 
 std::ostream& ProbitNoise::info(std::ostream& os, std::string indent)
@@ -37,3 +40,8 @@ std::string ProbitNoise::getStatus()
 {
    return std::string("Probit ") + std::to_string(threshold);
 }
+
+NoiseTypes ProbitNoise::getNoiseType() const
+{
+   return NoiseTypes::probit;
+}
@@ -25,6 +25,9 @@ namespace smurff {
 
       std::ostream& info(std::ostream& os, std::string indent) override;
       std::string getStatus() override;
+      NoiseTypes getNoiseType() const override;
+
+      double getThreshold() const;
    };
 
 }
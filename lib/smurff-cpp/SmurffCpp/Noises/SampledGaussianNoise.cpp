@@ -18,4 +18,9 @@ std::ostream& SampledGaussianNoise::info(std::ostream& os, std::string indent)
 std::string SampledGaussianNoise::getStatus()
 {
    return std::string("Sampled with fixed precision: ") + std::to_string(alpha);
-}
\ No newline at end of file
+}
+
+NoiseTypes SampledGaussianNoise::getNoiseType() const
+{
+   return NoiseTypes::sampled;
+}
@@ -29,3 +29,8 @@ std::string UnusedNoise::getStatus()
 {
    return std::string("Unused");
 }
+
+NoiseTypes UnusedNoise::getNoiseType() const
+{
+   return NoiseTypes::unused;
+}
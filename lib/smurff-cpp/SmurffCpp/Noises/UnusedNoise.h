@@ -22,6 +22,7 @@ public:
 
    std::ostream& info(std::ostream& os, std::string indent) override;
    std::string getStatus() override;
+   NoiseTypes getNoiseType() const override;
 };
 
 }
@@ -1,5 +1,9 @@
 #include "ILatentPrior.h"
 #include <SmurffCpp/Utils/counters.h>
+#include <SmurffCpp/Utils/BatchCholesky.h>
+#include <SmurffCpp/Utils/Distribution.h>
+
+#include <algorithm>
 
 using namespace smurff;
 
@@ -14,6 +18,8 @@ void ILatentPrior::init()
    rrs.init(Eigen::VectorXd::Zero(num_latent()));
    MMs.init(Eigen::MatrixXd::Zero(num_latent(), num_latent()));
 
+   m_latent_sampler_type = m_session->getConfig().getLatentSamplerType();
+
    //this is some new initialization
    init_Usum();
 }
@@ -100,28 +106,101 @@ void ILatentPrior::sample_latents()
    COUNTER("sample_latents");
    data().update_pnm(model(), m_mode);
 
+   // the rr of all items with one GEMM, when the data allows it
+   m_has_mu_lambda_all = data().getMuLambdaAll(model(), m_mode, m_rr_all, m_MM_all);
+
    // for effiency, we keep + update Ucol and UUcol by every thread
    thread_vector<Eigen::VectorXd> Ucol(Eigen::VectorXd::Zero(num_latent()));
    thread_vector<Eigen::MatrixXd> UUcol(Eigen::MatrixXd::Zero(num_latent(), num_latent()));
 
-   #pragma omp parallel for schedule(guided)
-   for(int n = 0; n < U().cols(); n++)
+   const WorkPartition &partition = data().partition(m_mode);
+
+   // heavy items one at a time, getMuLambda splits their observations over all threads
+   for(int n : partition.heavy_items())
    {
-       #pragma omp task
+      select_rng_stream(m_mode, n);
+      sample_latent(n);
+      data().update_residuals(model(), m_mode, n);
+
+      const auto& col = U().col(n);
+      Ucol.local().noalias() += col;
+      UUcol.local().noalias() += col * col.transpose();
+   }
+
+   // the other items in chunks of about equal cost, the batched sampler
+   // hands out blocks of consecutive items, the single one item by item
+   const int block_size = (m_latent_sampler_type == LatentSamplerTypes::batched) ? BatchCholesky::BATCH_SIZE : 1;
+
+   threads::parallel_for(0, partition.num_chunks(), [&](std::int64_t c)
+   {
+       const int end = partition.chunk_end(c);
+       int n = partition.chunk_begin(c);
+       while(n < end)
        {
-           sample_latent(n);
-           const auto& col = U().col(n);
-           Ucol.local().noalias() += col;
-           UUcol.local().noalias() += col * col.transpose();
+           if (partition.is_heavy(n))
+           {
+              n++;
+              continue;
+           }
+
+           const int from = n;
+           while(n < end && n - from < block_size && !partition.is_heavy(n))
+              n++;
+
+           if (block_size == 1)
+           {
+              select_rng_stream(m_mode, from);
+              sample_latent(from);
+           }
+           else
+              sample_latent_block(from, n);
+
+           for(int i = from; i < n; i++)
+           {
+              data().update_residuals(model(), m_mode, i);
+
+              const auto& col = U().col(i);
+              Ucol.local().noalias() += col;
+              UUcol.local().noalias() += col * col.transpose();
+           }
        }
-   }
+   });
+
+   m_has_mu_lambda_all = false;
 
    Usum  = Ucol.combine();
    UUsum = UUcol.combine();
 
+   select_rng_stream(m_mode, -1);
    update_prior();
 }
 
+void ILatentPrior::getMuLambda(int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const
+{
+   if (m_has_mu_lambda_all)
+   {
+      rr.noalias() += m_rr_all.col(n);
+      MM.noalias() += m_MM_all;
+   }
+   else if (data().partition(m_mode).is_heavy(n))
+   {
+      data().getMuLambdaSplit(model(), m_mode, n, rr, MM);
+   }
+   else
+   {
+      data().getMuLambda(model(), m_mode, n, rr, MM);
+   }
+}
+
+void ILatentPrior::sample_latent_block(int from, int to)
+{
+   for(int n = from; n < to; n++)
+   {
+      select_rng_stream(m_mode, n);
+      sample_latent(n);
+   }
+}
+
 bool ILatentPrior::save(std::shared_ptr<const StepFile> sf) const
 {
     return false;
@@ -26,6 +26,7 @@ public:
    std::shared_ptr<Session> m_session;
    std::uint32_t m_mode;
    std::string m_name = "xxxx";
+   LatentSamplerTypes m_latent_sampler_type = Config::LATENT_SAMPLER_DEFAULT_VALUE;
 
    smurff::thread_vector<Eigen::VectorXd> rrs;
    smurff::thread_vector<Eigen::MatrixXd> MMs;
@@ -76,8 +77,24 @@ public:
    virtual void sample_latents();
    virtual void sample_latent(int n) = 0;
 
+   // samples columns [from, to) of U together
+   // used by the batched latent sampler, default samples them one by one
+   virtual void sample_latent_block(int from, int to);
+
    virtual void update_prior() = 0;
 
+protected:
+   // adds the data part of rr and MM of item n: the column of the batched
+   // data().getMuLambdaAll during sample_latents, data().getMuLambdaSplit for
+   // heavy items of the partition, data().getMuLambda otherwise
+   void getMuLambda(int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM) const;
+
+private:
+   // set at the start of sample_latents when data().getMuLambdaAll succeeds
+   bool m_has_mu_lambda_all = false;
+   Eigen::MatrixXd m_rr_all;
+   Eigen::MatrixXd m_MM_all;
+
 private:
    void init_Usum();
    Eigen::VectorXd Usum;
@@ -4,9 +4,14 @@
 #include <SmurffCpp/IO/GenericIO.h>
 
 #include <SmurffCpp/Utils/linop.h>
+#include <SmurffCpp/Utils/Distribution.h>
 
 using namespace smurff;
 
+// with incremental Uhat, the full beta * F' is still recomputed every this many
+// iterations so that rounding errors of the updates do not accumulate
+static const int UHAT_FULL_RECOMPUTE_INTERVAL = 16;
+
 MacauOnePrior::MacauOnePrior(std::shared_ptr<Session> session, uint32_t mode)
    : NormalOnePrior(session, mode, "MacauOnePrior")
 {
@@ -28,24 +33,43 @@ void MacauOnePrior::init()
    beta_precision = Eigen::VectorXd::Constant(num_latent(), bp0);
    beta_precision_a0 = 0.1;
    beta_precision_b0 = 0.1;
+
+   incremental_uhat = choose_incremental_uhat(Features->nnz(), Features->rows());
+   uhat_iter = 0;
 }
 
 void MacauOnePrior::update_prior()
 {
    sample_mu_lambda(U());
    sample_beta(U());
-   Features->compute_uhat(Uhat, beta);
+   update_uhat();
 
    if (enable_beta_precision_sampling)
       sample_beta_precision();
 }
 
+// At the end of the beta sweep Z = U - mu - beta * F' (see sample_beta), so the new
+// Uhat costs num_latent x num_item instead of num_latent x nnz(F) for compute_uhat.
+bool MacauOnePrior::choose_incremental_uhat(std::uint64_t nnz, int num_item)
+{
+   return nnz > (std::uint64_t)num_item;
+}
+
+void MacauOnePrior::update_uhat()
+{
+   if (incremental_uhat && ++uhat_iter < UHAT_FULL_RECOMPUTE_INTERVAL)
+      return;
+
+   Features->compute_uhat(Uhat, beta);
+   uhat_iter = 0;
+}
+
 const Eigen::VectorXd MacauOnePrior::getMu(int n) const
 {
    return this->mu + Uhat.col(n);
 }
 
-void MacauOnePrior::addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, double beta_precision_a, double tolerance_a, bool direct_a, bool enable_beta_precision_sampling_a, bool)
+void MacauOnePrior::addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, double beta_precision_a, double tolerance_a, bool direct_a, bool enable_beta_precision_sampling_a, bool, bool, PreconditionerTypes)
 {
    //FIXME: remove old code
 
@@ -70,17 +94,20 @@ void MacauOnePrior::addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, d
 void MacauOnePrior::sample_beta(const Eigen::MatrixXd &U)
 {
    // updating beta and beta_var
-   const int nfeat = beta.cols();
    const int N = U.cols();
    const int blocksize = 4;
 
-   Eigen::MatrixXd Z;
+   const int nblocks = (num_latent() + blocksize - 1) / blocksize;
+
+   // with the counter based generator each block of rows has its own stream
+   const Philox4x32 stream = get_rng_stream();
 
-   #pragma omp parallel for private(Z) schedule(static, 1)
-   for (int dstart = 0; dstart < num_latent(); dstart += blocksize)
+   threads::parallel_for(0, nblocks, [&](std::int64_t b)
    {
+      const int dstart = b * blocksize;
+      select_rng_stream(m_mode, -1, 1 + b);
       const int dcount = std::min(blocksize, num_latent() - dstart);
-      Z.resize(dcount, U.cols());
+      Eigen::MatrixXd Z(dcount, U.cols());
 
       for (int i = 0; i < N; i++)
       {
@@ -91,11 +118,11 @@ void MacauOnePrior::sample_beta(const Eigen::MatrixXd &U)
          }
       }
 
-      for (int f = 0; f < nfeat; f++)
+      Eigen::VectorXd randvals(dcount);
+      // for every feature f, with zx = Z[dstart : dstart + dcount, :] * F[:, f]:
+      // Z[dstart : dstart + dcount, :] += F[:, f] * delta_beta'
+      Features->column_sweep(Z, [&](int f, const Eigen::VectorXd& zx, Eigen::VectorXd& delta_beta)
       {
-         Eigen::VectorXd zx(dcount), delta_beta(dcount), randvals(dcount);
-         // zx = Z[dstart : dstart + dcount, :] * F[:, f]
-         Features->At_mul_Bt(zx, f, Z);
          // TODO: check if sampling randvals for whole [nfeat x dcount] matrix works faster
          bmrandn_single_thread(randvals);
 
@@ -110,10 +137,23 @@ void MacauOnePrior::sample_beta(const Eigen::MatrixXd &U)
 
             beta(dx, f) = beta_new;
          }
-         // Z[dstart : dstart + dcount, :] += F[:, f] * delta_beta'
-         Features->add_Acol_mul_bt(Z, f, delta_beta);
+      });
+
+      // Z[dstart : dstart + dcount, :] = U - mu - beta * F' for the new beta
+      if (incremental_uhat)
+      {
+         for (int i = 0; i < N; i++)
+         {
+            for (int d = 0; d < dcount; d++)
+            {
+               int dx = d + dstart;
+               Uhat(dx, i) = U(dx, i) - mu(dx) - Z(d, i);
+            }
+         }
       }
-   }
+   });
+
+   set_rng_stream(stream);
 }
 
 void MacauOnePrior::sample_mu_lambda(const Eigen::MatrixXd &U)
@@ -123,14 +163,10 @@ void MacauOnePrior::sample_mu_lambda(const Eigen::MatrixXd &U)
    int N = U.cols();
 
    Eigen::MatrixXd Udelta(num_latent(), N);
-   #pragma omp parallel for schedule(static)
-   for (int i = 0; i < N; i++)
+   threads::parallel_for_blocks(0, N, [&](std::int64_t from, std::int64_t to)
    {
-      for (int d = 0; d < num_latent(); d++)
-      {
-         Udelta(d, i) = U(d, i) - Uhat(d, i);
-      }
-   }
+      Udelta.middleCols(from, to - from) = U.middleCols(from, to - from) - Uhat.middleCols(from, to - from);
+   });
    std::tie(mu, Lambda) = CondNormalWishart(Udelta, Eigen::VectorXd::Constant(num_latent(), 0.0), 2.0, WI, num_latent());
 }
 
@@ -140,23 +176,12 @@ void MacauOnePrior::sample_beta_precision()
    Eigen::VectorXd beta_precision_b = Eigen::VectorXd::Constant(beta.rows(), beta_precision_b0);
    const int D = beta.rows();
    const int F = beta.cols();
-   #pragma omp parallel
+   thread_vector<Eigen::VectorXd> tmp(Eigen::VectorXd::Zero(D));
+   threads::parallel_for_blocks(0, F, [&](std::int64_t from, std::int64_t to)
    {
-      Eigen::VectorXd tmp(D);
-      tmp.setZero();
-      #pragma omp for schedule(static)
-      for (int f = 0; f < F; f++)
-      {
-         for (int d = 0; d < D; d++)
-         {
-            tmp(d) += std::pow(beta(d, f), 2);
-         }
-      }
-      #pragma omp critical
-      {
-         beta_precision_b += tmp / 2;
-      }
-   }
+      tmp.local() += beta.middleCols(from, to - from).rowwise().squaredNorm();
+   });
+   beta_precision_b += tmp.combine() / 2;
    for (int d = 0; d < D; d++)
    {
       beta_precision(d) = rgamma(beta_precision_a, 1.0 / beta_precision_b(d));
@@ -182,6 +207,9 @@ void MacauOnePrior::restore(std::shared_ptr<const StepFile> sf)
    THROWERROR_FILE_NOT_EXIST(path);
 
    smurff::matrix_io::eigen::read_matrix(path, beta);
+
+   Features->compute_uhat(Uhat, beta);
+   uhat_iter = 0;
 }
 
 std::ostream& MacauOnePrior::status(std::ostream &os, std::string indent) const
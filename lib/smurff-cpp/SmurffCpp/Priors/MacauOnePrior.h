@@ -22,6 +22,9 @@ public:
    Eigen::VectorXd F_colsq;   // sum-of-squares for every feature (column)
 
    Eigen::MatrixXd beta;      // link matrix
+
+   bool incremental_uhat = false; // Uhat is taken from the residuals of the beta sweep
+   int uhat_iter = 0;             // update_prior calls since the last full compute_uhat
    
    double beta_precision_a0; // Hyper-prior for beta_precision
    double beta_precision_b0; // Hyper-prior for beta_precision
@@ -56,7 +59,7 @@ public:
    //FIXME: tolerance_a and direct_a are not really used. 
    //should remove later after PriorFactory is properly implemented. 
    //No reason generalizing addSideInfo between priors
-   void addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, double beta_precision_a, double tolerance_a, bool direct_a, bool enable_beta_precision_sampling_a, bool throw_on_cholesky_error_a);
+   void addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, double beta_precision_a, double tolerance_a, bool direct_a, bool enable_beta_precision_sampling_a, bool throw_on_cholesky_error_a, bool warm_start_a = false, PreconditionerTypes preconditioner_a = PreconditionerTypes::none);
 
 public:
 
@@ -72,6 +75,12 @@ public:
 
    void sample_beta_precision();
 
+   //used in update_prior
+
+   void update_uhat();
+
+   static bool choose_incremental_uhat(std::uint64_t nnz, int num_item);
+
 public:
 
    bool save(std::shared_ptr<const StepFile> sf) const override;
@@ -6,13 +6,35 @@
 #include <SmurffCpp/Utils/Distribution.h>
 #include <SmurffCpp/Utils/Error.h>
 #include <SmurffCpp/Utils/counters.h>
+#include <SmurffCpp/Utils/MatrixUtils.h>
 
 #include <SmurffCpp/Utils/linop.h>
 
+#include <algorithm>
 #include <ios>
+#include <cmath>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 using namespace smurff;
 
+// the block CG preconditioner is rebuilt when beta_precision moved
+// more than this fraction away from the value it was built for
+static const double PRECONDITIONER_REBUILD_TOL = 0.1;
+
+// the dual (item space) solver replaces block CG only up to this number of
+// items (about 7 GFlop at init and 256 MB of memory) and only when there are
+// at least DUAL_MIN_FEAT_RATIO times more features than items
+static const int DUAL_MAX_ITEMS = 4096;
+static const int DUAL_MIN_FEAT_RATIO = 2;
+
+// F F' is assembled by blocks of at most DUAL_BLOCK_SIZE rows, fewer when a
+// dense block of rows of F would hold more than DUAL_BLOCK_ENTRIES values
+static const int DUAL_BLOCK_SIZE = 256;
+static const std::int64_t DUAL_BLOCK_ENTRIES = 16 * 1024 * 1024;
+
 MacauPrior::MacauPrior()
     : NormalPrior()
 {
@@ -23,6 +45,8 @@ MacauPrior::MacauPrior(std::shared_ptr<Session> session, uint32_t mode)
 {
     beta_precision = SideInfoConfig::BETA_PRECISION_DEFAULT_VALUE;
     tol = SideInfoConfig::TOL_DEFAULT_VALUE;
+    warm_start = false;
+    preconditioner_type = PreconditionerTypes::none;
 
     enable_beta_precision_sampling = Config::ENABLE_BETA_PRECISION_SAMPLING_DEFAULT_VALUE;
 }
@@ -37,12 +61,14 @@ void MacauPrior::init()
 
    THROWERROR_ASSERT_MSG(Features->rows() == num_item(), "Number of rows in train must be equal to number of rows in features");
 
-   if (use_FtF)
+   use_dual = choose_dual(Features->rows(), Features->cols(), use_FtF);
+   if (use_dual)
+   {
+      compute_FFt_eigen();
+   }
+   else if (use_FtF)
    {
-      std::uint64_t dim = num_feat();
-      FtF_plus_precision.resize(dim, dim);
-      Features->At_mul_A(FtF_plus_precision);
-      FtF_plus_precision.diagonal().array() += beta_precision;
+      compute_FtF_eigen();
    }
 
    Uhat.resize(num_latent(), Features->rows());
@@ -110,33 +136,153 @@ void MacauPrior::update_prior()
         // uses: beta
         // writes: FtF
         COUNTER("sample_beta_precision");
-        double old_beta = beta_precision;
         beta_precision = sample_beta_precision(BBt, Lambda, beta_precision_nu0, beta_precision_mu0, beta().cols());
-        FtF_plus_precision.diagonal().array() += beta_precision - old_beta;
    }
 }
 
+// Throws before allocating count dense n x n matrices, plus extra doubles of
+// temporaries, if they do not fit in the physical memory of this machine.
+// Skipped where it cannot be queried.
+static void check_dense_memory(std::int64_t n, int count, const std::string &what, std::int64_t extra = 0)
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    const double needs = 8. * (count * (double)n * (double)n + (double)extra);
+    const double available = (double)sysconf(_SC_PHYS_PAGES) * (double)sysconf(_SC_PAGESIZE);
+    if (available > 0 && needs > available)
+    {
+        THROWERROR(what + " needs " + std::to_string(needs / 1024. / 1024. / 1024.) + " GB of memory, but only " +
+                   std::to_string(available / 1024. / 1024. / 1024.) + " GB are available. Use the CG solver (direct = 0) instead.");
+    }
+#endif
+}
+
+// F'F is factorized only once: with F'F = V diag(lambda) V', for any
+// beta_precision (F'F + beta_precision I)^-1 = V diag(1 / (lambda + beta_precision)) V'
+void MacauPrior::compute_FtF_eigen()
+{
+    COUNTER("compute_FtF_eigen");
+    // F'F and its eigenvectors
+    check_dense_memory(num_feat(), 2, "Eigendecomposition of F'F");
+    Eigen::MatrixXd FtF(num_feat(), num_feat());
+    Features->At_mul_A(FtF);
+
+    // FtF is overwritten, so only two num_feat x num_feat matrices are alive
+    smurff::matrix_utils::symmetric_eigen(FtF, FtF_eigenvectors, FtF_eigenvalues);
+
+    // F'F is positive semi-definite, negative eigenvalues are rounding errors
+    FtF_eigenvalues = FtF_eigenvalues.cwiseMax(0.0);
+}
+
+// The dual formulation only needs the num_items x num_items matrix F F'. With
+// more features than items it always beats the direct feature space solver.
+// Block CG costs depend on the number of nonzeros and iterations, so it is only
+// replaced when F F' is small and clearly smaller than F'F.
+bool MacauPrior::choose_dual(int num_item, int num_feat, bool direct)
+{
+    if (num_feat <= num_item)
+        return false;
+
+    if (direct)
+        return true;
+
+    return num_item <= DUAL_MAX_ITEMS && (std::int64_t)num_feat >= (std::int64_t)DUAL_MIN_FEAT_RATIO * num_item;
+}
+
+// F F' = U diag(mu) U', assembled from the generic side info products:
+// rows i .. i+b of F are E * F with E the rows i .. i+b of the identity,
+// and (E * F) * F' gives the same rows of F F'. E * F is dense, so b shrinks
+// with the number of features.
+void MacauPrior::compute_FFt_eigen()
+{
+    COUNTER("compute_FFt_eigen");
+    const int n = Features->rows();
+    const std::int64_t nf = Features->cols();
+    const int block = (int)std::max<std::int64_t>(1, std::min<std::int64_t>(DUAL_BLOCK_SIZE, DUAL_BLOCK_ENTRIES / nf));
+
+    // E, E * F and (E * F) * F' are alive next to F F' and its eigenvectors
+    check_dense_memory(n, 2, "Eigendecomposition of F F'", (std::int64_t)block * (2 * n + nf));
+    Eigen::MatrixXd FFt(n, n);
+
+    Eigen::MatrixXd E, F_rows, FFt_rows;
+    for (int i = 0; i < n; i += block)
+    {
+        const int b = std::min(block, n - i);
+        E.setZero(b, n);
+        E.middleCols(i, b).setIdentity();
+        F_rows = Features->A_mul_B(E);
+        Features->compute_uhat(FFt_rows, F_rows);
+        FFt.middleRows(i, b) = FFt_rows;
+    }
+
+    smurff::matrix_utils::symmetric_eigen(FFt, FFt_eigenvectors, FFt_eigenvalues);
+    FFt_eigenvalues = FFt_eigenvalues.cwiseMax(0.0);
+}
+
 void MacauPrior::sample_beta()
 {
     COUNTER("sample_beta");
-    if (use_FtF)
+    if (use_dual)
     {
-        // uses: FtF, Ft_y, 
+        // Woodbury: (F'F + bp I)^-1 = (I - F' (F F' + bp I)^-1 F) / bp
+        // uses: FFt_eigenvectors, FFt_eigenvalues, beta_precision, Ft_y, F
         // writes: m_beta
-        // complexity: num_feat^3
-        beta() = FtF_plus_precision.llt().solve(Ft_y.transpose()).transpose();
+        // complexity: num_latent x num_items x (num_items + nnz per item)
+        Eigen::MatrixXd Ft_y_Ft;
+        Features->compute_uhat(Ft_y_Ft, Ft_y); // num_latent x num_items
+        Eigen::MatrixXd Z = Ft_y_Ft * FFt_eigenvectors;
+        Z *= (FFt_eigenvalues.array() + beta_precision).inverse().matrix().asDiagonal();
+        Ft_y_Ft.noalias() = Z * FFt_eigenvectors.transpose();
+        beta() = (Ft_y - Features->A_mul_B(Ft_y_Ft)) / beta_precision;
+    }
+    else if (use_FtF)
+    {
+        // uses: FtF_eigenvectors, FtF_eigenvalues, beta_precision, Ft_y
+        // writes: m_beta
+        // complexity: num_latent x num_feat x num_feat
+        Eigen::MatrixXd Ft_y_V = Ft_y * FtF_eigenvectors;
+        Ft_y_V *= (FtF_eigenvalues.array() + beta_precision).inverse().matrix().asDiagonal();
+        beta().noalias() = Ft_y_V * FtF_eigenvectors.transpose();
     } 
     else
     {
         // uses: Features, beta_precision, Ft_y, 
         // writes: beta
         // complexity: num_feat x num_feat x num_iter
-        blockcg_iter = Features->solve_blockcg(beta(), beta_precision, Ft_y, tol, 32, 8, throw_on_cholesky_error);
+        update_preconditioner();
+        blockcg_iter = Features->solve_blockcg(beta(), beta_precision, Ft_y, tol, 32, 8, throw_on_cholesky_error, warm_start, preconditioner.get());
+        blockcg_iter_total += blockcg_iter;
+        blockcg_calls++;
     }
     // complexity: num_feat x num_feat x num_latent
     BBt = beta() * beta().transpose();
 }
 
+void MacauPrior::update_preconditioner()
+{
+    if (preconditioner_type == PreconditionerTypes::none)
+        return;
+
+    if (preconditioner && std::abs(beta_precision - preconditioner->reg()) <= PRECONDITIONER_REBUILD_TOL * preconditioner->reg())
+        return;
+
+    COUNTER("build preconditioner");
+    switch (preconditioner_type)
+    {
+    case PreconditionerTypes::jacobi:
+        preconditioner = std::make_shared<linop::JacobiPreconditioner>(*Features, beta_precision);
+        break;
+    case PreconditionerTypes::blockjacobi:
+        preconditioner = std::make_shared<linop::BlockJacobiPreconditioner>(*Features, beta_precision);
+        break;
+    case PreconditionerTypes::nystrom:
+        preconditioner = std::make_shared<linop::NystromPreconditioner>(*Features, beta_precision);
+        break;
+    default:
+        THROWERROR("Unknown preconditioner type");
+    }
+    preconditioner_builds++;
+}
+
 const Eigen::VectorXd MacauPrior::getMu(int n) const
 {
    return mu + Uhat.col(n);
@@ -157,7 +303,7 @@ void MacauPrior::compute_Ft_y(Eigen::MatrixXd& Ft_y)
    Ft_y += std::sqrt(beta_precision) * HyperU2;
 }
 
-void MacauPrior::addSideInfo(const std::shared_ptr<ISideInfo>& side, double bp, double to, bool di, bool sa, bool th)
+void MacauPrior::addSideInfo(const std::shared_ptr<ISideInfo>& side, double bp, double to, bool di, bool sa, bool th, bool ws, PreconditionerTypes pc)
 {
     Features = side;
     beta_precision = bp;
@@ -165,6 +311,9 @@ void MacauPrior::addSideInfo(const std::shared_ptr<ISideInfo>& side, double bp,
     use_FtF = di;
     enable_beta_precision_sampling = sa;
     throw_on_cholesky_error = th;
+    warm_start = ws;
+    preconditioner_type = pc;
+    preconditioner.reset();
 
     // Hyper-prior for beta_precision (mean 1.0, var of 1e+3):
     beta_precision_mu0 = 1.0;
@@ -196,14 +345,29 @@ std::ostream& MacauPrior::info(std::ostream &os, std::string indent)
    os << indent << " SideInfo: ";
    Features->print(os);
    os << indent << " Method: ";
-   if (use_FtF)
+   if (use_dual)
    {
-      os << "Cholesky Decomposition";
-      double needs_gb = (double)num_feat() / 1024. * (double)num_feat() / 1024. / 1024.;
+      // eigendecomposition ~ 10 n^3 flops once, two n^2 x num_latent GEMMs per sample
+      const double n = Features->rows();
+      const double needs_gb = 2. * 8. * n * n / 1024. / 1024. / 1024.;
+      const double init_gflop = 10. * n * n * n / 1e9;
+      const double sample_gflop = 4. * n * n * num_latent() / 1e9;
+      os << "Dual (item space) eigendecomposition of F F' [" << Features->rows() << " x " << Features->rows() << "]"
+         << " instead of " << (use_FtF ? "F'F" : "CG") << " [" << num_feat() << " x " << num_feat() << "]" << std::endl;
+      os << indent << "  needing " << needs_gb << " GB of memory, "
+         << init_gflop << " GFlop at init and " << sample_gflop << " GFlop per sample" << std::endl;
+   }
+   else if (use_FtF)
+   {
+      os << "Eigendecomposition of F'F";
+      double needs_gb = 8. * (double)num_feat() / 1024. * (double)num_feat() / 1024. / 1024.;
       if (needs_gb > 1.0) os << " (needing " << needs_gb << " GB of memory)";
       os << std::endl;
    } else {
-      os << "CG Solver with tolerance: " << std::scientific << tol << std::fixed << std::endl;
+      os << "CG Solver with tolerance: " << std::scientific << tol << std::fixed;
+      if (warm_start) os << ", warm start";
+      if (preconditioner_type != PreconditionerTypes::none) os << ", " << preconditionerTypeToString(preconditioner_type) << " preconditioner";
+      os << std::endl;
    }
    os << indent << " BetaPrecision: ";
    if (enable_beta_precision_sampling)
@@ -222,8 +386,15 @@ std::ostream &MacauPrior::status(std::ostream &os, std::string indent) const
 {
    os << indent << m_name << ": " << std::endl;
    indent += "  ";
-   os << indent << "blockcg iter = " << blockcg_iter << std::endl;
-   os << indent << "FtF_plus_precision= " << FtF_plus_precision.norm() << std::endl;
+   if (!use_FtF && !use_dual)
+   {
+      os << indent << "blockcg iter = " << blockcg_iter;
+      if (blockcg_calls > 0) os << " (avg " << (double)blockcg_iter_total / blockcg_calls << " over " << blockcg_calls << " calls)";
+      os << std::endl;
+      if (preconditioner) os << indent << "preconditioner builds = " << preconditioner_builds << " (reg = " << preconditioner->reg() << ")" << std::endl;
+   }
+   if (use_dual) os << indent << "FFt eigenvalues = [" << FFt_eigenvalues.minCoeff() << ", " << FFt_eigenvalues.maxCoeff() << "]" << std::endl;
+   else if (use_FtF) os << indent << "FtF eigenvalues = [" << FtF_eigenvalues.minCoeff() << ", " << FtF_eigenvalues.maxCoeff() << "]" << std::endl;
    os << indent << "HyperU       = " << HyperU.norm() << std::endl;
    os << indent << "HyperU2      = " << HyperU2.norm() << std::endl;
    os << indent << "Beta         = " << beta().norm() << std::endl;
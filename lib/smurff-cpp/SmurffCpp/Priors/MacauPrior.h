@@ -8,6 +8,8 @@
 #include <SmurffCpp/Priors/NormalPrior.h>
 
 #include <SmurffCpp/SideInfo/ISideInfo.h>
+#include <SmurffCpp/Configs/SideInfoConfig.h>
+#include <SmurffCpp/Utils/Preconditioner.h>
 
 namespace smurff {
 
@@ -24,13 +26,18 @@ public:
 
    Eigen::MatrixXd Uhat;             // num_latent x num_items
    Eigen::MatrixXd Udelta;           // num_latent x num_items
-   Eigen::MatrixXd FtF_plus_precision;    // num_feat   x num feat
+   Eigen::MatrixXd FtF_eigenvectors;      // num_feat   x num_feat -- F'F = V diag(lambda) V'
+   Eigen::VectorXd FtF_eigenvalues;       // num_feat
+   Eigen::MatrixXd FFt_eigenvectors;      // num_items  x num_items -- F F' = U diag(mu) U'
+   Eigen::VectorXd FFt_eigenvalues;       // num_items
    Eigen::MatrixXd HyperU;           // num_latent x num_items
    Eigen::MatrixXd HyperU2;          // num_latent x num_feat
    Eigen::MatrixXd Ft_y;             // num_latent x num_feat -- RHS
    Eigen::MatrixXd BBt;              // num_latent x num_latent
 
-   int blockcg_iter;
+   int blockcg_iter;                 // iterations of the last solve_blockcg
+   long blockcg_iter_total = 0;      // iterations of all solve_blockcg calls
+   int blockcg_calls = 0;
    
    double beta_precision_mu0; // Hyper-prior for beta_precision
    double beta_precision_nu0; // Hyper-prior for beta_precision
@@ -39,8 +46,14 @@ public:
    double beta_precision;
    double tol = 1e-6;
    bool use_FtF;
+   bool use_dual = false;            // solve for beta in item space, through F F'
    bool enable_beta_precision_sampling;
    bool throw_on_cholesky_error;
+   bool warm_start;                  // start block CG from the previous beta
+
+   PreconditionerTypes preconditioner_type;
+   std::shared_ptr<linop::Preconditioner> preconditioner; // rebuilt when beta_precision drifts away from preconditioner->reg()
+   int preconditioner_builds = 0;
 
 private:
    MacauPrior();
@@ -61,11 +74,15 @@ public:
    int num_feat() const { return Features->cols(); }
 
    void compute_Ft_y(Eigen::MatrixXd& Ft_y);
+   void compute_FtF_eigen();
+   void compute_FFt_eigen();
+   static bool choose_dual(int num_item, int num_feat, bool direct);
    virtual void sample_beta();
+   void update_preconditioner();
 
 public:
 
-   void addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, double beta_precision_a, double tolerance_a, bool direct_a, bool enable_beta_precision_sampling_a, bool throw_on_cholesky_error_a);
+   void addSideInfo(const std::shared_ptr<ISideInfo>& side_info_a, double beta_precision_a, double tolerance_a, bool direct_a, bool enable_beta_precision_sampling_a, bool throw_on_cholesky_error_a, bool warm_start_a = false, PreconditionerTypes preconditioner_a = PreconditionerTypes::none);
 
 public:
    bool save(std::shared_ptr<const StepFile> sf) const override;
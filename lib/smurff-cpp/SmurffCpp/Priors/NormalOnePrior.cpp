@@ -48,7 +48,7 @@ void NormalOnePrior::sample_latent(int d)
    Eigen::MatrixXd XX = Eigen::MatrixXd::Zero(K, K);
    Eigen::VectorXd yX = Eigen::VectorXd::Zero(K);
 
-   data().getMuLambda(model(), m_mode, d, yX, XX);
+   getMuLambda(d, yX, XX);
 
    // add hyperparams
    yX.noalias() += Lambda * mu;
@@ -11,6 +11,7 @@
 
 #include <SmurffCpp/Utils/Distribution.h>
 #include <SmurffCpp/Utils/Error.h>
+#include <SmurffCpp/Utils/FixedSize.h>
 
 using namespace smurff;
 
@@ -42,6 +43,11 @@ void NormalPrior::init()
    mu0.setZero();
    b0 = 2;
    df = K;
+
+   if (m_latent_sampler_type == LatentSamplerTypes::batched)
+      batches.init(BatchCholesky(K));
+
+   Ws.init(Eigen::MatrixXd(K, 0));
 }
 
 const Eigen::VectorXd NormalPrior::getMu(int n) const
@@ -54,23 +60,54 @@ void NormalPrior::update_prior()
    std::tie(mu, Lambda) = CondNormalWishart(num_item(), getUUsum(), getUsum(), mu0, b0, WI, df);
 }
 
-//n is an index of column in U matrix
-void  NormalPrior::sample_latent(int n)
+void NormalPrior::add_mu_lambda(int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM)
 {
    const auto &mu_u = getMu(n);
 
-   Eigen::VectorXd &rr = rrs.local();
-   Eigen::MatrixXd &MM = MMs.local();
-
    rr.setZero();
    MM.setZero();
 
    // add pnm
-   data().getMuLambda(model(), m_mode, n, rr, MM);
+   getMuLambda(n, rr, MM);
 
    // add hyperparams
    rr.noalias() += Lambda * mu_u;
    MM.noalias() += Lambda;
+}
+
+void NormalPrior::sample_latents()
+{
+   // Lambda only changes in update_prior, after all latents are sampled
+   chol_Lambda.compute(Lambda);
+   if(chol_Lambda.info() != Eigen::Success)
+   {
+      THROWERROR("Cholesky Decomposition failed!");
+   }
+
+   ILatentPrior::sample_latents();
+}
+
+//n is an index of column in U matrix
+void  NormalPrior::sample_latent(int n)
+{
+   // O(K^3) factorization of MM is more expensive than the low rank
+   // updates for items with fewer than K/2 observations
+   const int rank = data().pnm_rank(m_mode, n);
+   if (rank >= 0 && 2 * rank < num_latent())
+      return sample_latent_lowrank(n);
+
+   switch(num_latent())
+   {
+      case 8:  return sample_latent_fixed<8>(n);
+      case 16: return sample_latent_fixed<16>(n);
+      case 32: return sample_latent_fixed<32>(n);
+      default: break;
+   }
+
+   Eigen::VectorXd &rr = rrs.local();
+   Eigen::MatrixXd &MM = MMs.local();
+
+   add_mu_lambda(n, rr, MM);
 
    //Solve system of linear equations for x: MM * x = rr - not exactly correct  because we have random part
    //Sample from multivariate normal distribution with mean rr and precision matrix MM
@@ -91,6 +128,111 @@ void  NormalPrior::sample_latent(int n)
    U().col(n).noalias() = rr; // rr is equal to x
 }
 
+// With Lambda = L * L^T and MM = Lambda + W * W^T, C = L^-1 * W:
+//    MM = L * (I + C * C^T) * L^T
+// so x = L^-T * y, with y ~ N((I + C * C^T)^-1 * L^-1 * rr, (I + C * C^T)^-1).
+// y is sampled as (I + C * C^T)^-1 * (L^-1 * rr + z1 + C * z2) with z1, z2
+// standard normal, where the inverse is applied with the Woodbury identity
+//    (I + C * C^T)^-1 = I - C * (I + C^T * C)^-1 * C^T
+// which only needs a Cholesky decomposition of the small rank x rank matrix.
+void NormalPrior::sample_latent_lowrank(int n)
+{
+   const int K = num_latent();
+   Eigen::VectorXd &rr = rrs.local();
+   Eigen::MatrixXd &W = Ws.local();
+
+   rr.setZero();
+   data().getMuLambdaLowRank(model(), m_mode, n, rr, W);
+   rr.noalias() += Lambda * getMu(n);
+
+   chol_Lambda.matrixL().solveInPlace(rr); // y = L^-1 * b
+   rr.noalias() += nrandn(K);
+
+   const int rank = W.cols();
+   if (rank > 0)
+   {
+      chol_Lambda.matrixL().solveInPlace(W); // C = L^-1 * W
+      rr.noalias() += W * nrandn(rank);
+
+      Eigen::MatrixXd S = Eigen::MatrixXd::Identity(rank, rank);
+      S.selfadjointView<Eigen::Lower>().rankUpdate(W.transpose());
+      Eigen::LLT<Eigen::MatrixXd> chol_S(S); // I + C^T * C is always positive definite
+
+      Eigen::VectorXd t = chol_S.solve(W.transpose() * rr);
+      rr.noalias() -= W * t;
+   }
+
+   chol_Lambda.matrixU().solveInPlace(rr); // x = L^-T * y
+   U().col(n).noalias() = rr;
+}
+
+template<int K>
+void NormalPrior::sample_latent_fixed(int n)
+{
+   typedef Eigen::Matrix<double, K, K> MatrixK;
+   typedef Eigen::Matrix<double, K, 1> VectorK;
+
+   Eigen::VectorXd &rr = rrs.local();
+   Eigen::MatrixXd &MM = MMs.local();
+
+   add_mu_lambda(n, rr, MM);
+
+   Eigen::LLT<MatrixK> chol(MM);
+   if(chol.info() != Eigen::Success)
+   {
+      THROWERROR("Cholesky Decomposition failed!");
+   }
+
+   VectorK x = rr;
+   chol.matrixL().solveInPlace(x); // solve for y: y = L^-1 * b
+   x.noalias() += nrandn(K);
+   chol.matrixU().solveInPlace(x); // solve for x: x = U^-1 * y
+
+   U().col(n).noalias() = x;
+}
+
+//same as sample_latent for columns [from, to), but the Cholesky decompositions
+//and triangular solves of all columns are done together in one BatchCholesky
+void NormalPrior::sample_latent_block(int from, int to)
+{
+   Eigen::VectorXd &rr = rrs.local();
+   Eigen::MatrixXd &MM = MMs.local();
+   BatchCholesky &batch = batches.local();
+
+   THROWERROR_ASSERT(to - from <= BatchCholesky::BATCH_SIZE);
+
+   // with the counter based generator, the noise of column n comes from stream n
+   // as in sample_latent, keep the position of each stream for nrandn below.
+   // With mt19937 add_mu_lambda of all columns draws (e.g. probit latents)
+   // before the first nrandn, so the draws differ from sample_latent
+   Philox4x32 streams[BatchCholesky::BATCH_SIZE];
+
+   batch.clear();
+   for(int n = from; n < to; n++)
+   {
+      select_rng_stream(m_mode, n);
+      add_mu_lambda(n, rr, MM);
+      batch.add(MM, rr);
+      streams[n - from] = get_rng_stream();
+   }
+
+   if (!batch.factorize())
+   {
+      THROWERROR("Cholesky Decomposition failed!");
+   }
+
+   batch.solveL(); // solve for y: y = L^-1 * b
+   for(int b = 0; b < batch.size(); b++)
+   {
+      set_rng_stream(streams[b]);
+      batch.add_rhs(b, nrandn(num_latent()));
+   }
+   batch.solveLt(); // solve for x: x = U^-1 * y
+
+   for(int b = 0; b < batch.size(); b++)
+      batch.get(b, U().col(from + b));
+}
+
 std::ostream &NormalPrior::status(std::ostream &os, std::string indent) const
 {
    os << indent << m_name << ": mu = " <<  mu.norm() << std::endl;
@@ -7,6 +7,7 @@
 
 #include <SmurffCpp/Utils/Distribution.h>
 #include <SmurffCpp/Utils/ThreadVector.hpp>
+#include <SmurffCpp/Utils/BatchCholesky.h>
 
 #include <SmurffCpp/Priors/ILatentPrior.h>
 
@@ -26,6 +27,13 @@ public:
   int b0;
   int df;
 
+private:
+  smurff::thread_vector<BatchCholesky> batches;
+
+  // Cholesky factor of Lambda, computed once per sample_latents for the low rank sampler
+  Eigen::LLT<Eigen::MatrixXd> chol_Lambda;
+  smurff::thread_vector<Eigen::MatrixXd> Ws;
+
 protected:
    NormalPrior()
       : ILatentPrior(){}
@@ -40,7 +48,23 @@ public:
   //for example in MacauPrior mu depends on Uhat.col(n)
   virtual const Eigen::VectorXd getMu(int n) const;
   
+  void sample_latents() override;
   void sample_latent(int n) override;
+  void sample_latent_block(int from, int to) override;
+
+protected:
+  // precision matrix MM and MM * mean rr of the conditional posterior of column n
+  void add_mu_lambda(int n, Eigen::VectorXd& rr, Eigen::MatrixXd& MM);
+
+private:
+  // sample_latent with compile-time num_latent (see Utils/FixedSize.h)
+  template<int K>
+  void sample_latent_fixed(int n);
+
+  // sample_latent for items with few observations, starting from chol_Lambda
+  void sample_latent_lowrank(int n);
+
+public:
 
   void update_prior() override;
   std::ostream &status(std::ostream &os, std::string indent) const override;
@@ -10,6 +10,9 @@
 
 #include <SmurffCpp/SideInfo/DenseSideInfo.h>
 #include <SmurffCpp/SideInfo/SparseSideInfo.h>
+#include <SmurffCpp/SideInfo/BinarySideInfo.h>
+#include <SmurffCpp/SideInfo/ReducedDenseSideInfo.h>
+#include <SmurffCpp/SideInfo/CompositeSideInfo.h>
 
 namespace smurff {
 
@@ -40,33 +43,48 @@ std::shared_ptr<ILatentPrior> PriorFactory::create_macau_prior(std::shared_ptr<S
                                                                const std::vector<std::shared_ptr<SideInfoConfig> >& config_items)
 {
    THROWERROR_ASSERT(side_infos.size() == config_items.size());
+   THROWERROR_ASSERT_MSG(!side_infos.empty(), "macau prior needs side info");
 
    std::shared_ptr<MacauPrior> prior(new MacauPrior(session, -1));
 
-   for (std::size_t i = 0; i < side_infos.size(); i++)
+   const auto& config_item = config_items.front();
+   const auto& side_info_config = config_item->getSideInfo();
+   const auto& noise_config = side_info_config->getNoiseConfig();
+
+   // several side infos for the same mode are column blocks of one feature
+   // matrix with a single beta, so they must share the solver and noise settings
+   for (const auto& item : config_items)
    {
-      const auto& side_info = side_infos.at(i);
-      const auto& config_item = config_items.at(i);
-      const auto& side_info_config = config_item->getSideInfo();
-      const auto& noise_config = side_info_config->getNoiseConfig();
+      const auto& item_noise = item->getSideInfo()->getNoiseConfig();
+      THROWERROR_ASSERT_MSG(item->getTol() == config_item->getTol(), "all side info of a mode must have the same tol");
+      THROWERROR_ASSERT_MSG(item->getDirect() == config_item->getDirect(), "all side info of a mode must have the same direct setting");
+      THROWERROR_ASSERT_MSG(item->getThrowOnCholeskyError() == config_item->getThrowOnCholeskyError(), "all side info of a mode must have the same throw_on_cholesky_error setting");
+      THROWERROR_ASSERT_MSG(item->getWarmStart() == config_item->getWarmStart(), "all side info of a mode must have the same warm_start setting");
+      THROWERROR_ASSERT_MSG(item->getPreconditioner() == config_item->getPreconditioner(), "all side info of a mode must have the same preconditioner");
+      THROWERROR_ASSERT_MSG(item_noise.getNoiseType() == noise_config.getNoiseType() && item_noise.getPrecision() == noise_config.getPrecision(),
+         "all side info of a mode must have the same noise");
+   }
+
+   std::shared_ptr<ISideInfo> side_info = side_infos.front();
+   if (side_infos.size() > 1)
+      side_info = std::make_shared<CompositeSideInfo>(side_infos);
 
-      switch (noise_config.getNoiseType())
+   switch (noise_config.getNoiseType())
+   {
+   case NoiseTypes::fixed:
+      {
+         prior->addSideInfo(side_info, noise_config.getPrecision(), config_item->getTol(), config_item->getDirect(), false, config_item->getThrowOnCholeskyError(), config_item->getWarmStart(), config_item->getPreconditioner());
+      }
+      break;
+   case NoiseTypes::adaptive: // deprecated!
+   case NoiseTypes::sampled:
       {
-      case NoiseTypes::fixed:
-         {
-            prior->addSideInfo(side_info, noise_config.getPrecision(), config_item->getTol(), config_item->getDirect(), false, config_item->getThrowOnCholeskyError());
-         }
-         break;
-      case NoiseTypes::adaptive: // deprecated!
-      case NoiseTypes::sampled:
-         {
-            prior->addSideInfo(side_info, noise_config.getPrecision(), config_item->getTol(), config_item->getDirect(), true, config_item->getThrowOnCholeskyError());
-         }
-         break;
-      default:
-         {
-            THROWERROR("Unexpected noise type " + smurff::noiseTypeToString(noise_config.getNoiseType()) + " specified for macau prior. Allowed are: fixed and sampled noise.");
-         }
+         prior->addSideInfo(side_info, noise_config.getPrecision(), config_item->getTol(), config_item->getDirect(), true, config_item->getThrowOnCholeskyError(), config_item->getWarmStart(), config_item->getPreconditioner());
+      }
+      break;
+   default:
+      {
+         THROWERROR("Unexpected noise type " + smurff::noiseTypeToString(noise_config.getNoiseType()) + " specified for macau prior. Allowed are: fixed and sampled noise.");
       }
    }
 
@@ -87,10 +105,18 @@ std::shared_ptr<ILatentPrior> PriorFactory::create_macau_prior(std::shared_ptr<S
    {
       const auto &sideinfoConfig = item->getSideInfo();
 
-      if (sideinfoConfig->isDense())
+      if (sideinfoConfig->isDense() && item->getDenseStorage() != DenseStorageTypes::float64)
+      {
+         side_infos.push_back(std::make_shared<ReducedDenseSideInfo>(sideinfoConfig, item->getDenseStorage()));
+      }
+      else if (sideinfoConfig->isDense())
       {
          side_infos.push_back(std::make_shared<DenseSideInfo>(sideinfoConfig));
       }
+      else if (sideinfoConfig->isBinary())
+      {
+         side_infos.push_back(std::make_shared<BinarySideInfo>(sideinfoConfig));
+      }
       else
       {
          side_infos.push_back(std::make_shared<SparseSideInfo>(sideinfoConfig));
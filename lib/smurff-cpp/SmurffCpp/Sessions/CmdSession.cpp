@@ -45,6 +45,9 @@ static const char *THRESHOLD_NAME = "threshold";
 static const char *VERBOSE_NAME = "verbose";
 static const char *VERSION_NAME = "version";
 static const char *SEED_NAME = "seed";
+static const char *LATENT_SAMPLER_NAME = "latent-sampler";
+static const char *RESIDUAL_CACHE_NAME = "residual-cache";
+static const char *RANDOM_GENERATOR_NAME = "random-generator";
 
 namespace po = boost::program_options;
 
@@ -57,7 +60,8 @@ po::options_description get_desc()
 	(INI_NAME, po::value<std::string>(), "read options from this .ini file")
 	(NUM_THREADS_NAME, po::value<int>()->default_value(Config::NUM_THREADS_DEFAULT_VALUE), "number of threads (0 = default by OpenMP)")
 	(VERBOSE_NAME, po::value<int>()->default_value(Config::VERBOSE_DEFAULT_VALUE), "verbosity of output (0, 1, 2 or 3)")
-	(SEED_NAME, po::value<int>()->default_value(Config::RANDOM_SEED_DEFAULT_VALUE), "random number generator seed");
+	(SEED_NAME, po::value<int>()->default_value(Config::RANDOM_SEED_DEFAULT_VALUE), "random number generator seed")
+	(RANDOM_GENERATOR_NAME, po::value<std::string>()->default_value(randomGeneratorTypeToString(Config::RANDOM_GENERATOR_DEFAULT_VALUE)), "random number generator: <mt19937|philox>, philox draws the random numbers of each item from its own stream");
 
     po::options_description train_desc("Used during training");
     train_desc.add_options()
@@ -67,6 +71,8 @@ po::options_description get_desc()
 	(BURNIN_NAME, po::value<int>()->default_value(Config::BURNIN_DEFAULT_VALUE), "number of samples to discard")
 	(NSAMPLES_NAME, po::value<int>()->default_value(Config::NSAMPLES_DEFAULT_VALUE), "number of samples to collect")
 	(NUM_LATENT_NAME, po::value<int>()->default_value(Config::NUM_LATENT_DEFAULT_VALUE), "number of latent dimensions")
+	(LATENT_SAMPLER_NAME, po::value<std::string>()->default_value(latentSamplerTypeToString(Config::LATENT_SAMPLER_DEFAULT_VALUE)), "engine for sampling latent vectors: <single|batched>, both sample from the same distribution, the draws are identical only with the philox generator")
+	(RESIDUAL_CACHE_NAME, po::value<bool>()->default_value(Config::RESIDUAL_CACHE_DEFAULT_VALUE), "keep the train residuals from the sampling pass, so the noise update does not recompute them (uses 4 bytes per nonzero)")
 	(THRESHOLD_NAME, po::value<double>()->default_value(Config::THRESHOLD_DEFAULT_VALUE), "threshold for binary classification and AUC calculation");
 
     po::options_description predict_desc("Used during prediction");
@@ -176,6 +182,8 @@ fill_config(const po::variables_map &vm)
     filler.set<int,         &Config::setNSamples>(NSAMPLES_NAME);
     filler.set<int,         &Config::setNumLatent>(NUM_LATENT_NAME);
     filler.set<int,         &Config::setNumThreads>(NUM_THREADS_NAME);
+    filler.set<std::string, &Config::setLatentSamplerType>(LATENT_SAMPLER_NAME);
+    filler.set<bool,        &Config::setResidualCache>(RESIDUAL_CACHE_NAME);
     filler.set<std::string, &Config::setSavePrefix>(SAVE_PREFIX_NAME);
     filler.set<std::string, &Config::setSaveExtension>(SAVE_EXTENSION_NAME);
     filler.set<int,         &Config::setSaveFreq>(SAVE_FREQ_NAME);
@@ -183,6 +191,7 @@ fill_config(const po::variables_map &vm)
     filler.set<double,      &Config::setThreshold>(THRESHOLD_NAME);
     filler.set<int,         &Config::setVerbose>(VERBOSE_NAME);
     filler.set<int,         &Config::setRandomSeed>(SEED_NAME);
+    filler.set<std::string, &Config::setRandomGeneratorType>(RANDOM_GENERATOR_NAME);
 
     return config;
 }
@@ -168,13 +168,23 @@ bool Session::step()
         THROWERROR_ASSERT(is_init);
 
         auto starti = tick();
+        set_rng_iteration(m_iter);
         for (auto &p : m_priors)
             p->sample_latents();
-        data().update(model());
-        auto endi = tick();
+
+        // noise and predictions both only read the model, update them concurrently
+        threads::task_group updates;
+        updates.run([this]() {
+            select_rng_stream(-1, -1, 1);
+            data().update(model());
+        });
 
         //WARNING: update is an expensive operation because of sort (when calculating AUC)
-        m_pred->update(m_model, m_iter < m_config.getBurnin());
+        const bool burnin = m_iter < m_config.getBurnin();
+        updates.run([this, burnin]() { m_pred->update(m_model, burnin); });
+
+        updates.wait();
+        auto endi = tick();
 
         m_secs_per_iter = endi - starti;
         m_secs_total += m_secs_per_iter;
@@ -454,10 +464,11 @@ std::string StatusItem::asCsvString() const
 void Session::initRng()
 {
     //init random generator
+    const bool counter_based = m_config.getRandomGeneratorType() == RandomGeneratorTypes::philox;
     if (m_config.getRandomSeedSet())
-        init_bmrng(m_config.getRandomSeed());
+        init_bmrng(m_config.getRandomSeed(), counter_based);
     else
-        init_bmrng();
+        init_bmrng(counter_based);
 }
 
 std::shared_ptr<IPriorFactory> Session::create_prior_factory() const
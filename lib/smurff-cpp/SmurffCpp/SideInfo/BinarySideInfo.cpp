@@ -0,0 +1,269 @@
+#include "BinarySideInfo.h"
+
+#include <SmurffCpp/Utils/linop.h>
+#include <SmurffCpp/Utils/counters.h>
+#include <SmurffCpp/Utils/omp_util.h>
+#include <SmurffCpp/Utils/Error.h>
+
+#include <algorithm>
+
+using namespace smurff;
+
+// counting sort of the nonzeros (major[k], minor[k]) by major index, nonzeros with
+// the same major index keep their order
+static void compress(int nmajor, const std::vector<std::uint32_t> &major, const std::vector<std::uint32_t> &minor,
+                     std::vector<std::uint64_t> &ptr, std::vector<std::uint32_t> &idx)
+{
+   ptr.assign(nmajor + 1, 0);
+   for (auto m : major) ptr[m + 1]++;
+   for (int m = 0; m < nmajor; m++) ptr[m + 1] += ptr[m];
+
+   std::vector<std::uint64_t> pos(ptr.begin(), ptr.end() - 1);
+   idx.resize(minor.size());
+   for (std::size_t k = 0; k < minor.size(); k++) idx[pos[major[k]]++] = minor[k];
+}
+
+BinarySideInfo::BinarySideInfo(const std::shared_ptr<MatrixConfig> &mc)
+   : m_rows(mc->getNRow()), m_cols(mc->getNCol())
+{
+   const auto &rows = mc->getRows();
+   const auto &cols = mc->getCols();
+
+   // by column, then by row from that: the column indices of each row come out sorted
+   compress(m_cols, cols, rows, m_col_ptr, m_col_rows);
+
+   std::vector<std::uint32_t> major(m_col_rows.size()), minor(m_col_rows.size());
+   for (int j = 0; j < m_cols; j++)
+   {
+      for (std::uint64_t p = m_col_ptr[j]; p < m_col_ptr[j + 1]; p++)
+      {
+         major[p] = m_col_rows[p];
+         minor[p] = j;
+      }
+   }
+   compress(m_rows, major, minor, m_row_ptr, m_row_cols);
+
+   // and by column again, now with sorted row indices
+   major.clear(); minor.clear();
+   for (int i = 0; i < m_rows; i++)
+   {
+      for (std::uint64_t p = m_row_ptr[i]; p < m_row_ptr[i + 1]; p++)
+      {
+         major.push_back(m_row_cols[p]);
+         minor.push_back(i);
+      }
+   }
+   compress(m_cols, major, minor, m_col_ptr, m_col_rows);
+
+   for (int i = 0; i < m_rows; i++)
+   {
+      auto begin = m_row_cols.begin() + m_row_ptr[i];
+      auto end = m_row_cols.begin() + m_row_ptr[i + 1];
+      THROWERROR_ASSERT_MSG(std::adjacent_find(begin, end) == end, "probable presence of duplicate records in " + mc->getFilename());
+   }
+}
+
+int BinarySideInfo::cols() const
+{
+   return m_cols;
+}
+
+int BinarySideInfo::rows() const
+{
+   return m_rows;
+}
+
+std::uint64_t BinarySideInfo::nnz() const
+{
+   return m_row_cols.size();
+}
+
+std::ostream& BinarySideInfo::print(std::ostream &os) const
+{
+   double percent = 100.0 * (double)nnz() / (double)m_rows / (double)m_cols;
+   os << "SparseBinary " << nnz() << " [" << m_rows << ", " << m_cols << "] ("
+      << percent << "%)" << std::endl;
+   return os;
+}
+
+bool BinarySideInfo::is_dense() const
+{
+   return false;
+}
+
+// uhat(:, i) = sum of beta(:, j) over the nonzeros (i, j) in row i
+void BinarySideInfo::compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta)
+{
+   COUNTER("compute_uhat");
+   uhat.resize(beta.rows(), m_rows);
+   threads::parallel_for(0, m_rows, [&](std::int64_t i)
+   {
+      uhat.col(i).setZero();
+      for (std::uint64_t p = m_row_ptr[i]; p < m_row_ptr[i + 1]; p++)
+         uhat.col(i) += beta.col(m_row_cols[p]);
+   });
+}
+
+// out(k, j) = number of rows with a nonzero in both column k and column j
+void BinarySideInfo::At_mul_A(Eigen::MatrixXd& out)
+{
+   COUNTER("At_mul_A");
+   out.setZero(m_cols, m_cols);
+   threads::parallel_for(0, m_cols, [&](std::int64_t j)
+   {
+      for (std::uint64_t p = m_col_ptr[j]; p < m_col_ptr[j + 1]; p++)
+      {
+         const int i = m_col_rows[p];
+         for (std::uint64_t q = m_row_ptr[i]; q < m_row_ptr[i + 1]; q++)
+            out(m_row_cols[q], j) += 1.0;
+      }
+   });
+}
+
+void BinarySideInfo::At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols)
+{
+   out.setZero(ncols, ncols);
+   for (int j = col; j < col + ncols; j++)
+   {
+      for (std::uint64_t p = m_col_ptr[j]; p < m_col_ptr[j + 1]; p++)
+      {
+         const int i = m_col_rows[p];
+         const auto end = m_row_cols.begin() + m_row_ptr[i + 1];
+         for (auto it = std::lower_bound(m_row_cols.begin() + m_row_ptr[i], end, (std::uint32_t)col);
+              it != end && (int)*it < col + ncols; ++it)
+            out(*it - col, j - col) += 1.0;
+      }
+   }
+}
+
+// out(:, j) = sum of A(:, i) over the nonzeros (i, j) in column j
+Eigen::MatrixXd BinarySideInfo::A_mul_B(Eigen::MatrixXd& A)
+{
+   COUNTER("A_mul_B");
+   Eigen::MatrixXd out(A.rows(), m_cols);
+   threads::parallel_for(0, m_cols, [&](std::int64_t j)
+   {
+      out.col(j).setZero();
+      for (std::uint64_t p = m_col_ptr[j]; p < m_col_ptr[j + 1]; p++)
+         out.col(j) += A.col(m_col_rows[p]);
+   });
+   return out;
+}
+
+// Two passes without partial results, T(:, i) = B * F(i, :)' by rows of F,
+// then out(:, j) = sum of T(:, i) over the nonzeros of column j of F by
+// columns, so every thread writes only its own output columns
+void BinarySideInfo::AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const
+{
+   const int nrhs = B.rows();
+   const int nfeat = B.cols();
+
+   THROWERROR_ASSERT_MSG(nfeat == m_cols, "B.cols() must equal F.cols()");
+
+   Eigen::MatrixXd T(nrhs, m_rows);
+   threads::parallel_for_blocks(0, m_rows, [&](std::int64_t from, std::int64_t to)
+   {
+      for (std::int64_t i = from; i < to; i++)
+      {
+         double *t = T.data() + i * nrhs;
+         std::fill(t, t + nrhs, 0.0);
+         for (std::uint64_t p = m_row_ptr[i]; p < m_row_ptr[i + 1]; p++)
+         {
+            const double *b = B.data() + (std::int64_t)m_row_cols[p] * nrhs;
+            for (int r = 0; r < nrhs; r++) t[r] += b[r];
+         }
+      }
+   });
+
+   out.resize(nrhs, nfeat);
+   threads::parallel_for_blocks(0, nfeat, [&](std::int64_t from, std::int64_t to)
+   {
+      for (std::int64_t j = from; j < to; j++)
+      {
+         double *o = out.data() + j * nrhs;
+         const double *b = B.data() + j * nrhs;
+         for (int r = 0; r < nrhs; r++) o[r] = reg * b[r];
+         for (std::uint64_t p = m_col_ptr[j]; p < m_col_ptr[j + 1]; p++)
+         {
+            const double *t = T.data() + (std::int64_t)m_col_rows[p] * nrhs;
+            for (int r = 0; r < nrhs; r++) o[r] += t[r];
+         }
+      }
+   });
+}
+
+int BinarySideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error, bool warm_start, const linop::Preconditioner *precond)
+{
+   COUNTER("solve_blockcg");
+   return smurff::linop::solve_blockcg(X, *this, reg, B, tol, blocksize, excess, throw_on_cholesky_error, warm_start, precond);
+}
+
+// number of nonzeros per column
+Eigen::VectorXd BinarySideInfo::col_square_sum()
+{
+   COUNTER("col_square_sum");
+   Eigen::VectorXd out(m_cols);
+   for (int j = 0; j < m_cols; j++)
+      out(j) = (double)(m_col_ptr[j + 1] - m_col_ptr[j]);
+   return out;
+}
+
+// Y = X[:,col]' * B'
+void BinarySideInfo::At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B)
+{
+   COUNTER("At_mul_Bt");
+   Y.setZero(B.rows());
+   for (std::uint64_t p = m_col_ptr[col]; p < m_col_ptr[col + 1]; p++)
+      Y += B.col(m_col_rows[p]);
+}
+
+// computes Z += A[:,col] * b', where a and b are vectors
+void BinarySideInfo::add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b)
+{
+   COUNTER("add_Acol_mul_bt");
+   for (std::uint64_t p = m_col_ptr[col]; p < m_col_ptr[col + 1]; p++)
+      Z.col(m_col_rows[p]) += b;
+}
+
+// column_sweep for a Z with W rows: the W sums stay in registers and Z is
+// updated in place, Z(:, i) is contiguous
+template<int W>
+static void column_sweep_binary(int ncols, const std::uint64_t *col_ptr, const std::uint32_t *col_rows, Eigen::MatrixXd& Z, const ISideInfo::ColumnUpdate& update)
+{
+   double* z = Z.data();
+
+   Eigen::VectorXd zx(W), b(W);
+   for (int col = 0; col < ncols; col++)
+   {
+      double t[W];
+      for (int w = 0; w < W; w++) t[w] = 0.0;
+      for (std::uint64_t p = col_ptr[col]; p < col_ptr[col + 1]; p++)
+      {
+         const double *zi = z + (std::int64_t)col_rows[p] * W;
+         for (int w = 0; w < W; w++) t[w] += zi[w];
+      }
+      for (int w = 0; w < W; w++) zx(w) = t[w];
+
+      update(col, zx, b);
+
+      for (int w = 0; w < W; w++) t[w] = b(w);
+      for (std::uint64_t p = col_ptr[col]; p < col_ptr[col + 1]; p++)
+      {
+         double *zi = z + (std::int64_t)col_rows[p] * W;
+         for (int w = 0; w < W; w++) zi[w] += t[w];
+      }
+   }
+}
+
+void BinarySideInfo::column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update)
+{
+   COUNTER("column_sweep");
+   switch (Z.rows())
+   {
+   case 1: column_sweep_binary<1>(m_cols, m_col_ptr.data(), m_col_rows.data(), Z, update); break;
+   case 2: column_sweep_binary<2>(m_cols, m_col_ptr.data(), m_col_rows.data(), Z, update); break;
+   case 3: column_sweep_binary<3>(m_cols, m_col_ptr.data(), m_col_rows.data(), Z, update); break;
+   case 4: column_sweep_binary<4>(m_cols, m_col_ptr.data(), m_col_rows.data(), Z, update); break;
+   default: ISideInfo::column_sweep(Z, update);
+   }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <SmurffCpp/Configs/MatrixConfig.h>
+
+#include "ISideInfo.h"
+
+namespace smurff {
+
+// Sparse side information where every nonzero is 1.0 (fingerprints, .sbm files)
+//
+// Only the positions of the nonzeros are stored, once by row (CSR) and once
+// by column (CSC), 4 bytes per nonzero each. The products add up rows or
+// columns of the other operand instead of multiplying with the values.
+class BinarySideInfo : public ISideInfo
+{
+private:
+   int m_rows;
+   int m_cols;
+
+   // column indices of the nonzeros of row i are m_row_cols[m_row_ptr[i] .. m_row_ptr[i+1]], sorted
+   std::vector<std::uint64_t> m_row_ptr;
+   std::vector<std::uint32_t> m_row_cols;
+
+   // row indices of the nonzeros of column j are m_col_rows[m_col_ptr[j] .. m_col_ptr[j+1]], sorted
+   std::vector<std::uint64_t> m_col_ptr;
+   std::vector<std::uint32_t> m_col_rows;
+
+public:
+   BinarySideInfo(const std::shared_ptr<MatrixConfig> &);
+
+public:
+   int cols() const override;
+   int rows() const override;
+
+   std::uint64_t nnz() const override;
+
+public:
+   std::ostream& print(std::ostream &os) const override;
+
+   bool is_dense() const override;
+
+public:
+   //linop
+
+   void compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta) override;
+
+   void At_mul_A(Eigen::MatrixXd& out) override;
+
+   void At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols) override;
+
+   Eigen::MatrixXd A_mul_B(Eigen::MatrixXd& A) override;
+
+   // out = (F' * F * B' + reg * B')', one pass over the rows
+   // and one over the columns of F
+   void AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const;
+
+   int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const linop::Preconditioner *precond = nullptr) override;
+
+   Eigen::VectorXd col_square_sum() override;
+
+   void At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B) override;
+
+   void add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b) override;
+
+
+   void column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update) override;
+};
+
+}
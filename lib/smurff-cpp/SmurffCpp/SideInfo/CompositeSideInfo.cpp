@@ -0,0 +1,237 @@
+#include "CompositeSideInfo.h"
+
+#include <algorithm>
+
+#include <SmurffCpp/Utils/linop.h>
+#include <SmurffCpp/Utils/counters.h>
+#include <SmurffCpp/Utils/Error.h>
+
+using namespace smurff;
+
+CompositeSideInfo::CompositeSideInfo(const std::vector<std::shared_ptr<ISideInfo> >& blocks)
+   : m_blocks(blocks)
+{
+   THROWERROR_ASSERT_MSG(!m_blocks.empty(), "composite side info needs at least one block");
+
+   m_offsets.push_back(0);
+   for (const auto& block : m_blocks)
+   {
+      THROWERROR_ASSERT_MSG(block->rows() == m_blocks.front()->rows(),
+         "all side info blocks must have the same number of rows");
+      m_offsets.push_back(m_offsets.back() + block->cols());
+   }
+}
+
+int CompositeSideInfo::find_block(int col) const
+{
+   THROWERROR_ASSERT_MSG(col >= 0 && col < cols(), "column out of range");
+   return (int)(std::upper_bound(m_offsets.begin(), m_offsets.end(), col) - m_offsets.begin()) - 1;
+}
+
+int CompositeSideInfo::cols() const
+{
+   return m_offsets.back();
+}
+
+int CompositeSideInfo::rows() const
+{
+   return m_blocks.front()->rows();
+}
+
+std::uint64_t CompositeSideInfo::nnz() const
+{
+   std::uint64_t n = 0;
+   for (const auto& block : m_blocks)
+      n += block->nnz();
+   return n;
+}
+
+const std::vector<std::shared_ptr<ISideInfo> >& CompositeSideInfo::blocks() const
+{
+   return m_blocks;
+}
+
+int CompositeSideInfo::offset(int b) const
+{
+   return m_offsets.at(b);
+}
+
+std::ostream& CompositeSideInfo::print(std::ostream &os) const
+{
+   os << "Composite [" << rows() << ", " << cols() << "] of " << m_blocks.size() << " blocks:" << std::endl;
+   for (const auto& block : m_blocks)
+   {
+      os << "      ";
+      block->print(os);
+   }
+   return os;
+}
+
+bool CompositeSideInfo::is_dense() const
+{
+   return std::all_of(m_blocks.begin(), m_blocks.end(), [](const std::shared_ptr<ISideInfo>& block) { return block->is_dense(); });
+}
+
+// uhat = sum_b beta_b * F_b'
+void CompositeSideInfo::compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta)
+{
+   COUNTER("compute_uhat");
+   uhat.setZero(beta.rows(), rows());
+   Eigen::MatrixXd beta_b, uhat_b;
+   for (std::size_t b = 0; b < m_blocks.size(); b++)
+   {
+      beta_b = beta.middleCols(m_offsets[b], m_blocks[b]->cols());
+      m_blocks[b]->compute_uhat(uhat_b, beta_b);
+      uhat += uhat_b;
+   }
+}
+
+// The columns of F_b are copied one at a time into a dense ncols x rows matrix
+// with add_Acol_mul_bt, which costs nnz(F_b(:, col)) per column for every
+// storage type, and then multiplied with F_a.
+void CompositeSideInfo::cross_product(Eigen::MatrixXd& out, ISideInfo& a, ISideInfo& b, int col, int ncols)
+{
+   out.resize(ncols, a.cols());
+   Eigen::VectorXd one = Eigen::VectorXd::Ones(1);
+   Eigen::MatrixXd column(1, b.rows());
+   for (int c = 0; c < ncols; c += CROSS_BLOCK_SIZE)
+   {
+      const int n = std::min(CROSS_BLOCK_SIZE, ncols - c);
+      Eigen::MatrixXd Bt(n, b.rows());
+      for (int k = 0; k < n; k++)
+      {
+         column.setZero();
+         b.add_Acol_mul_bt(column, col + c + k, one);
+         Bt.row(k) = column.row(0);
+      }
+      out.middleRows(c, n) = a.A_mul_B(Bt);
+   }
+}
+
+void CompositeSideInfo::At_mul_A(Eigen::MatrixXd& out)
+{
+   COUNTER("At_mul_A");
+   At_mul_A_block(out, 0, cols());
+}
+
+// Diagonal blocks with the block's own At_mul_A, off-diagonal blocks with
+// cross_product, densifying the side with fewer columns in the range.
+void CompositeSideInfo::At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols)
+{
+   THROWERROR_ASSERT_MSG(ncols > 0 && col + ncols <= cols(), "column range out of range");
+
+   struct Range { int block; int col; int ncols; int pos; };
+   std::vector<Range> ranges;
+   for (int b = find_block(col); b < (int)m_blocks.size() && m_offsets[b] < col + ncols; b++)
+   {
+      const int first = std::max(col, m_offsets[b]);
+      const int last = std::min(col + ncols, m_offsets[b + 1]);
+      if (last > first)
+         ranges.push_back({b, first - m_offsets[b], last - first, first - col});
+   }
+
+   out.resize(ncols, ncols);
+   Eigen::MatrixXd tmp;
+   for (std::size_t i = 0; i < ranges.size(); i++)
+   {
+      const Range& r = ranges[i];
+      ISideInfo& block = *m_blocks[r.block];
+      if (r.ncols == block.cols())
+         block.At_mul_A(tmp);
+      else
+         block.At_mul_A_block(tmp, r.col, r.ncols);
+      out.block(r.pos, r.pos, r.ncols, r.ncols) = tmp;
+
+      for (std::size_t j = 0; j < i; j++)
+      {
+         const Range& s = ranges[j];
+         if (r.ncols <= s.ncols)
+         {
+            // tmp = F_r' * F_s
+            cross_product(tmp, *m_blocks[s.block], block, r.col, r.ncols);
+            out.block(r.pos, s.pos, r.ncols, s.ncols) = tmp.middleCols(s.col, s.ncols);
+         }
+         else
+         {
+            // tmp = F_s' * F_r
+            cross_product(tmp, block, *m_blocks[s.block], s.col, s.ncols);
+            out.block(r.pos, s.pos, r.ncols, s.ncols) = tmp.middleCols(r.col, r.ncols).transpose();
+         }
+         out.block(s.pos, r.pos, s.ncols, r.ncols) = out.block(r.pos, s.pos, r.ncols, s.ncols).transpose();
+      }
+   }
+}
+
+// A * F = [A * F_0, A * F_1, ...]
+Eigen::MatrixXd CompositeSideInfo::A_mul_B(Eigen::MatrixXd& A)
+{
+   COUNTER("A_mul_B");
+   Eigen::MatrixXd out(A.rows(), cols());
+   for (std::size_t b = 0; b < m_blocks.size(); b++)
+      out.middleCols(m_offsets[b], m_blocks[b]->cols()) = m_blocks[b]->A_mul_B(A);
+   return out;
+}
+
+void CompositeSideInfo::AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const
+{
+   THROWERROR_ASSERT_MSG(B.cols() == cols(), "B.cols() must equal F.cols()");
+
+   Eigen::MatrixXd T = Eigen::MatrixXd::Zero(B.rows(), rows());
+   Eigen::MatrixXd B_b, T_b;
+   for (std::size_t b = 0; b < m_blocks.size(); b++)
+   {
+      B_b = B.middleCols(m_offsets[b], m_blocks[b]->cols());
+      m_blocks[b]->compute_uhat(T_b, B_b);
+      T += T_b;
+   }
+
+   out.resize(B.rows(), cols());
+   for (std::size_t b = 0; b < m_blocks.size(); b++)
+   {
+      const int ncols = m_blocks[b]->cols();
+      out.middleCols(m_offsets[b], ncols) = m_blocks[b]->A_mul_B(T);
+      out.middleCols(m_offsets[b], ncols) += reg * B.middleCols(m_offsets[b], ncols);
+   }
+}
+
+int CompositeSideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error, bool warm_start, const linop::Preconditioner *precond)
+{
+   COUNTER("solve_blockcg");
+   return smurff::linop::solve_blockcg(X, *this, reg, B, tol, blocksize, excess, throw_on_cholesky_error, warm_start, precond);
+}
+
+Eigen::VectorXd CompositeSideInfo::col_square_sum()
+{
+   COUNTER("col_square_sum");
+   Eigen::VectorXd out(cols());
+   for (std::size_t b = 0; b < m_blocks.size(); b++)
+      out.segment(m_offsets[b], m_blocks[b]->cols()) = m_blocks[b]->col_square_sum();
+   return out;
+}
+
+// Y = X[:,col]' * B'
+void CompositeSideInfo::At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B)
+{
+   const int b = find_block(col);
+   m_blocks[b]->At_mul_Bt(Y, col - m_offsets[b], B);
+}
+
+// computes Z += A[:,col] * b', where a and b are vectors
+void CompositeSideInfo::add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b)
+{
+   const int k = find_block(col);
+   m_blocks[k]->add_Acol_mul_bt(Z, col - m_offsets[k], b);
+}
+
+// each block sweeps its own columns with its own kernel, in block order
+void CompositeSideInfo::column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update)
+{
+   for (std::size_t b = 0; b < m_blocks.size(); b++)
+   {
+      const int offset = m_offsets[b];
+      m_blocks[b]->column_sweep(Z, [&](int col, const Eigen::VectorXd& zx, Eigen::VectorXd& bx)
+      {
+         update(offset + col, zx, bx);
+      });
+   }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "ISideInfo.h"
+
+namespace smurff {
+
+// Side info made of several blocks of features for the same rows,
+// F = [F_0, F_1, ...]
+//
+// Each block keeps its own storage (dense, reduced dense, sparse, binary) and
+// the products are done block by block, the concatenation is never formed.
+class CompositeSideInfo : public ISideInfo
+{
+public:
+   // columns of F_b densified at a time for the off-diagonal blocks of F'F
+   static const int CROSS_BLOCK_SIZE = 256;
+
+private:
+   std::vector<std::shared_ptr<ISideInfo> > m_blocks;
+
+   // block b holds columns m_offsets[b] .. m_offsets[b+1] of F
+   std::vector<int> m_offsets;
+
+   // index of the block holding column col
+   int find_block(int col) const;
+
+   // out = F_b(:, col:col+ncols)' * F_a, ncols x F_a.cols()
+   static void cross_product(Eigen::MatrixXd& out, ISideInfo& a, ISideInfo& b, int col, int ncols);
+
+public:
+   CompositeSideInfo(const std::vector<std::shared_ptr<ISideInfo> >& blocks);
+
+public:
+   int cols() const override;
+   int rows() const override;
+
+   std::uint64_t nnz() const override;
+
+   const std::vector<std::shared_ptr<ISideInfo> >& blocks() const;
+
+   // first column of block b
+   int offset(int b) const;
+
+public:
+   std::ostream& print(std::ostream &os) const override;
+
+   bool is_dense() const override;
+
+public:
+   //linop
+
+   void compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta) override;
+
+   void At_mul_A(Eigen::MatrixXd& out) override;
+
+   void At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols) override;
+
+   Eigen::MatrixXd A_mul_B(Eigen::MatrixXd& A) override;
+
+   // out = (F' * F * B' + reg * B')', T = B * F' summed over the blocks first
+   void AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const;
+
+   int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const linop::Preconditioner *precond = nullptr) override;
+
+   Eigen::VectorXd col_square_sum() override;
+
+   void At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B) override;
+
+   void add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b) override;
+
+   void column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update) override;
+};
+
+}
@@ -40,14 +40,20 @@ void DenseSideInfo::At_mul_A(Eigen::MatrixXd& out)
    out = m_side_info->transpose() * *m_side_info;
 }
 
+void DenseSideInfo::At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols)
+{
+   const auto &block = m_side_info->middleCols(col, ncols);
+   out.noalias() = block.transpose() * block;
+}
+
 Eigen::MatrixXd DenseSideInfo::A_mul_B(Eigen::MatrixXd& A)
 {
    return A * *m_side_info;
 }
 
-int DenseSideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error)
+int DenseSideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error, bool warm_start, const linop::Preconditioner *precond)
 {
-   return smurff::linop::solve_blockcg(X, *m_side_info, reg, B, tol, blocksize, excess, throw_on_cholesky_error);
+   return smurff::linop::solve_blockcg(X, *m_side_info, reg, B, tol, blocksize, excess, throw_on_cholesky_error, warm_start, precond);
 }
 
 Eigen::VectorXd DenseSideInfo::col_square_sum()
@@ -66,6 +72,18 @@ void DenseSideInfo::add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::Ve
    Z += (m_side_info->col(col) * b.transpose()).transpose();
 }
 
+void DenseSideInfo::column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update)
+{
+   const Eigen::MatrixXd& A = *m_side_info;
+   Eigen::VectorXd zx(Z.rows()), b(Z.rows());
+   for (int col = 0; col < A.cols(); col++)
+   {
+      zx.noalias() = Z * A.col(col);
+      update(col, zx, b);
+      Z.noalias() += b * A.col(col).transpose();
+   }
+}
+
 std::shared_ptr<Eigen::MatrixXd> DenseSideInfo::get_features()
 {
    return m_side_info;
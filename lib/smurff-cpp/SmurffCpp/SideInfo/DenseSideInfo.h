@@ -36,9 +36,11 @@ namespace smurff {
 
       void At_mul_A(Eigen::MatrixXd& out) override;
 
+      void At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols) override;
+
       Eigen::MatrixXd A_mul_B(Eigen::MatrixXd& A) override;
 
-      int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false) override;
+      int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const linop::Preconditioner *precond = nullptr) override;
 
       Eigen::VectorXd col_square_sum() override;
 
@@ -46,6 +48,9 @@ namespace smurff {
 
       void add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b) override;
 
+
+      void column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update) override;
+
       //only for tests
    public:
       std::shared_ptr<Eigen::MatrixXd> get_features();
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <functional>
 
 #include <Eigen/Dense>
 
 namespace smurff {
 
+   namespace linop { class Preconditioner; }
+
    class ISideInfo
    {
    public:
@@ -19,6 +23,9 @@ namespace smurff {
 
       virtual bool is_dense() const = 0;
 
+      // number of stored entries, the cost of a product with A is proportional to it
+      virtual std::uint64_t nnz() const { return (std::uint64_t)rows() * cols(); }
+
    public:
       //linop
 
@@ -26,15 +33,35 @@ namespace smurff {
 
       virtual void At_mul_A(Eigen::MatrixXd& out) = 0;
 
+      // out = A(:, col:col+ncols)' * A(:, col:col+ncols)
+      virtual void At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols) = 0;
+
       virtual Eigen::MatrixXd A_mul_B(Eigen::MatrixXd& A) = 0;
 
-      virtual int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false) = 0;
+      virtual int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const linop::Preconditioner *precond = nullptr) = 0;
 
       virtual Eigen::VectorXd col_square_sum() = 0;
 
       virtual void At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B) = 0;
 
       virtual void add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b) = 0;
+
+      // update(col, zx, b) is called with zx = Z * A(:, col) and fills b
+      typedef std::function<void(int col, const Eigen::VectorXd& zx, Eigen::VectorXd& b)> ColumnUpdate;
+
+      // Coordinate-wise sweep over all columns of A, in order. For every column
+      // zx = Z * A(:, col), then update(col, zx, b), then Z += b * A(:, col)'.
+      // Z is a small block of rows (Z.rows() x rows()).
+      virtual void column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update)
+      {
+         Eigen::VectorXd zx(Z.rows()), b(Z.rows());
+         for (int col = 0; col < cols(); col++)
+         {
+            At_mul_Bt(zx, col, Z);
+            update(col, zx, b);
+            add_Acol_mul_bt(Z, col, b);
+         }
+      }
    };
 
 }
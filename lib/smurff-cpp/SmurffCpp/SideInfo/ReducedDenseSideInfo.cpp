@@ -0,0 +1,258 @@
+#include "ReducedDenseSideInfo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <SmurffCpp/Utils/linop.h>
+#include <SmurffCpp/Utils/counters.h>
+#include <SmurffCpp/Utils/omp_util.h>
+#include <SmurffCpp/Utils/Error.h>
+
+using namespace smurff;
+
+ReducedDenseSideInfo::ReducedDenseSideInfo(const std::shared_ptr<MatrixConfig> &side_info, DenseStorageTypes storage)
+   : m_storage(storage), m_rows(side_info->getNRow()), m_cols(side_info->getNCol())
+{
+   THROWERROR_ASSERT_MSG(side_info->isDense(), "matrix config should be dense");
+   THROWERROR_ASSERT_MSG(storage != DenseStorageTypes::float64, "float64 side info is stored in DenseSideInfo");
+
+   Eigen::Map<const Eigen::MatrixXd> values(side_info->getValues().data(), m_rows, m_cols);
+
+   if (storage == DenseStorageTypes::float32)
+   {
+      m_f32 = values.cast<float>();
+      return;
+   }
+
+   m_u8.resize(m_rows, m_cols);
+   m_scale.resize(m_cols);
+   m_offset.resize(m_cols);
+
+   threads::parallel_for(0, m_cols, [&](std::int64_t j)
+   {
+      const double lo = values.col(j).minCoeff();
+      const double hi = values.col(j).maxCoeff();
+      const bool integral = (hi - lo <= 255.0) &&
+         (values.col(j).array() == values.col(j).array().round()).all();
+      m_offset(j) = lo;
+      m_scale(j) = integral ? 1.0 : (hi - lo) / 255.0;
+
+      const double inv_scale = (hi > lo) ? 1.0 / m_scale(j) : 0.0;
+      for (int i = 0; i < m_rows; i++)
+      {
+         const double q = std::round((values(i, j) - lo) * inv_scale);
+         m_u8(i, j) = (std::uint8_t)std::min(std::max(q, 0.0), 255.0);
+      }
+   });
+}
+
+void ReducedDenseSideInfo::decode(Eigen::MatrixXd& out, int row, int nrows, int col, int ncols) const
+{
+   if (m_storage == DenseStorageTypes::float32)
+   {
+      out = m_f32.block(row, col, nrows, ncols).cast<double>();
+   }
+   else
+   {
+      out = m_u8.block(row, col, nrows, ncols).cast<double>() * m_scale.segment(col, ncols).asDiagonal();
+      out.rowwise() += m_offset.segment(col, ncols).transpose();
+   }
+}
+
+int ReducedDenseSideInfo::cols() const
+{
+   return m_cols;
+}
+
+int ReducedDenseSideInfo::rows() const
+{
+   return m_rows;
+}
+
+DenseStorageTypes ReducedDenseSideInfo::storage() const
+{
+   return m_storage;
+}
+
+Eigen::MatrixXd ReducedDenseSideInfo::decoded() const
+{
+   Eigen::MatrixXd out;
+   decode(out, 0, m_rows, 0, m_cols);
+   return out;
+}
+
+std::ostream& ReducedDenseSideInfo::print(std::ostream &os) const
+{
+   os << (m_storage == DenseStorageTypes::float32 ? "DenseFloat32" : "DenseUint8")
+      << " [" << m_rows << ", " << m_cols << "]" << std::endl;
+   return os;
+}
+
+bool ReducedDenseSideInfo::is_dense() const
+{
+   return true;
+}
+
+static int num_panels(int n)
+{
+   return (n + ReducedDenseSideInfo::PANEL_SIZE - 1) / ReducedDenseSideInfo::PANEL_SIZE;
+}
+
+// out = A * F', each thread computes PANEL_SIZE columns of out from
+// PANEL_SIZE x PANEL_SIZE tiles of F
+void ReducedDenseSideInfo::mul_Ft(Eigen::MatrixXd& out, const Eigen::MatrixXd& A) const
+{
+   out.resize(A.rows(), m_rows);
+   threads::parallel_for(0, num_panels(m_rows), [&](std::int64_t p)
+   {
+      const int row = p * PANEL_SIZE;
+      const int nrows = std::min(PANEL_SIZE, m_rows - row);
+      out.middleCols(row, nrows).setZero();
+
+      Eigen::MatrixXd tile;
+      for (int col = 0; col < m_cols; col += PANEL_SIZE)
+      {
+         const int ncols = std::min(PANEL_SIZE, m_cols - col);
+         decode(tile, row, nrows, col, ncols);
+         out.middleCols(row, nrows).noalias() += A.middleCols(col, ncols) * tile.transpose();
+      }
+   });
+}
+
+// out = A * F, each thread computes PANEL_SIZE columns of out from
+// PANEL_SIZE x PANEL_SIZE tiles of F
+void ReducedDenseSideInfo::mul_F(Eigen::MatrixXd& out, const Eigen::MatrixXd& A) const
+{
+   out.resize(A.rows(), m_cols);
+   threads::parallel_for(0, num_panels(m_cols), [&](std::int64_t p)
+   {
+      const int col = p * PANEL_SIZE;
+      const int ncols = std::min(PANEL_SIZE, m_cols - col);
+      out.middleCols(col, ncols).setZero();
+
+      Eigen::MatrixXd tile;
+      for (int row = 0; row < m_rows; row += PANEL_SIZE)
+      {
+         const int nrows = std::min(PANEL_SIZE, m_rows - row);
+         decode(tile, row, nrows, col, ncols);
+         out.middleCols(col, ncols).noalias() += A.middleCols(row, nrows) * tile;
+      }
+   });
+}
+
+void ReducedDenseSideInfo::compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta)
+{
+   COUNTER("compute_uhat");
+   mul_Ft(uhat, beta);
+}
+
+void ReducedDenseSideInfo::At_mul_A(Eigen::MatrixXd& out)
+{
+   COUNTER("At_mul_A");
+   At_mul_A_block(out, 0, m_cols);
+}
+
+// every tile (i, j) of the lower triangle of out is computed by one thread from
+// tiles i and j of each panel of rows, the upper triangle is copied from it
+void ReducedDenseSideInfo::At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols)
+{
+   out.resize(ncols, ncols);
+
+   std::vector<std::pair<int, int> > tiles;
+   for (int i = 0; i < num_panels(ncols); i++)
+      for (int j = 0; j <= i; j++)
+         tiles.push_back(std::make_pair(i, j));
+
+   threads::parallel_for(0, tiles.size(), [&](std::int64_t t)
+   {
+      const int i = tiles[t].first;
+      const int j = tiles[t].second;
+      const int ci = i * PANEL_SIZE, ni = std::min(PANEL_SIZE, ncols - ci);
+      const int cj = j * PANEL_SIZE, nj = std::min(PANEL_SIZE, ncols - cj);
+      auto block = out.block(ci, cj, ni, nj);
+      block.setZero();
+
+      Eigen::MatrixXd tile_i, tile_j;
+      for (int row = 0; row < m_rows; row += PANEL_SIZE)
+      {
+         const int nrows = std::min(PANEL_SIZE, m_rows - row);
+         decode(tile_i, row, nrows, col + ci, ni);
+         if (i == j)
+         {
+            block.noalias() += tile_i.transpose() * tile_i;
+         }
+         else
+         {
+            decode(tile_j, row, nrows, col + cj, nj);
+            block.noalias() += tile_i.transpose() * tile_j;
+         }
+      }
+   });
+
+   out.triangularView<Eigen::StrictlyUpper>() = out.transpose();
+}
+
+Eigen::MatrixXd ReducedDenseSideInfo::A_mul_B(Eigen::MatrixXd& A)
+{
+   COUNTER("A_mul_B");
+   Eigen::MatrixXd out;
+   mul_F(out, A);
+   return out;
+}
+
+// T = B * F', then out = T * F + reg * B
+void ReducedDenseSideInfo::AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const
+{
+   THROWERROR_ASSERT_MSG(B.cols() == m_cols, "B.cols() must equal F.cols()");
+
+   Eigen::MatrixXd T;
+   mul_Ft(T, B);
+   mul_F(out, T);
+   out += reg * B;
+}
+
+int ReducedDenseSideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error, bool warm_start, const linop::Preconditioner *precond)
+{
+   COUNTER("solve_blockcg");
+   return smurff::linop::solve_blockcg(X, *this, reg, B, tol, blocksize, excess, throw_on_cholesky_error, warm_start, precond);
+}
+
+Eigen::VectorXd ReducedDenseSideInfo::col_square_sum()
+{
+   COUNTER("col_square_sum");
+   Eigen::VectorXd out(m_cols);
+   threads::parallel_for(0, num_panels(m_cols), [&](std::int64_t p)
+   {
+      const int col = p * PANEL_SIZE;
+      const int ncols = std::min(PANEL_SIZE, m_cols - col);
+      out.segment(col, ncols).setZero();
+
+      Eigen::MatrixXd tile;
+      for (int row = 0; row < m_rows; row += PANEL_SIZE)
+      {
+         decode(tile, row, std::min(PANEL_SIZE, m_rows - row), col, ncols);
+         out.segment(col, ncols) += tile.colwise().squaredNorm().transpose();
+      }
+   });
+   return out;
+}
+
+// Y = X[:,col]' * B'
+void ReducedDenseSideInfo::At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B)
+{
+   COUNTER("At_mul_Bt");
+   Eigen::MatrixXd column;
+   decode(column, 0, m_rows, col, 1);
+   Y = B * column.col(0);
+}
+
+// computes Z += A[:,col] * b', where a and b are vectors
+void ReducedDenseSideInfo::add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b)
+{
+   COUNTER("add_Acol_mul_bt");
+   Eigen::MatrixXd column;
+   decode(column, 0, m_rows, col, 1);
+   Z.noalias() += b * column.col(0).transpose();
+}
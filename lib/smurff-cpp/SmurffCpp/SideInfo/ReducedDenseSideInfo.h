@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <Eigen/Dense>
+
+#include <SmurffCpp/Configs/MatrixConfig.h>
+#include <SmurffCpp/Configs/SideInfoConfig.h>
+
+#include "ISideInfo.h"
+
+
+namespace smurff {
+
+   // Dense side info stored in reduced precision:
+   //  - float32: single precision values
+   //  - uint8: per column, value = offset(j) + scale(j) * q with q in 0 .. 255,
+   //    integer columns spanning at most 255 get scale 1 and are stored exactly
+   //
+   // The products convert tiles of PANEL_SIZE x PANEL_SIZE values to double and
+   // multiply them with double precision GEMM, so only the stored values are
+   // rounded, all sums are done in double. The decoded values a thread holds at
+   // a time do not depend on the size of F.
+   class ReducedDenseSideInfo : public ISideInfo
+   {
+   public:
+      static const int PANEL_SIZE = 256;
+
+   private:
+      DenseStorageTypes m_storage;
+      int m_rows;
+      int m_cols;
+
+      Eigen::MatrixXf m_f32;
+      Eigen::Matrix<std::uint8_t, Eigen::Dynamic, Eigen::Dynamic> m_u8;
+      Eigen::VectorXd m_scale;
+      Eigen::VectorXd m_offset;
+
+      // out = F(row:row+nrows, col:col+ncols) in double
+      void decode(Eigen::MatrixXd& out, int row, int nrows, int col, int ncols) const;
+
+      // out = A * F' and out = A * F
+      void mul_Ft(Eigen::MatrixXd& out, const Eigen::MatrixXd& A) const;
+      void mul_F(Eigen::MatrixXd& out, const Eigen::MatrixXd& A) const;
+
+   public:
+      ReducedDenseSideInfo(const std::shared_ptr<MatrixConfig> &, DenseStorageTypes storage);
+
+   public:
+      int cols() const override;
+
+      int rows() const override;
+
+      DenseStorageTypes storage() const;
+
+      // the side info as it is used in the products
+      Eigen::MatrixXd decoded() const;
+
+   public:
+      std::ostream& print(std::ostream &os) const override;
+
+      bool is_dense() const override;
+
+   public:
+      //linop
+
+      void compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta) override;
+
+      void At_mul_A(Eigen::MatrixXd& out) override;
+
+      void At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols) override;
+
+      Eigen::MatrixXd A_mul_B(Eigen::MatrixXd& A) override;
+
+      // out = (F' * F * B' + reg * B')'
+      void AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const;
+
+      int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const linop::Preconditioner *precond = nullptr) override;
+
+      Eigen::VectorXd col_square_sum() override;
+
+      void At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B) override;
+
+      void add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b) override;
+   };
+
+}
@@ -4,14 +4,22 @@
 #include <SmurffCpp/Utils/MatrixUtils.h>
 #include <SmurffCpp/Utils/counters.h>
 #include <SmurffCpp/IO/MatrixIO.h>
+#include <SmurffCpp/Utils/omp_util.h>
 
+#include <algorithm>
 #include <vector>
 
 using namespace smurff;
 
 SparseSideInfo::SparseSideInfo(const std::shared_ptr<smurff::MatrixConfig> &mc) {
     F = smurff::matrix_utils::sparse_to_eigen(*mc);
-    Ft = F.transpose();
+    F.makeCompressed();
+
+    m_col_start.assign(F.cols() + 1, 0);
+    for (int p = 0; p < F.nonZeros(); p++)
+        m_col_start[F.innerIndexPtr()[p] + 1]++;
+    for (int j = 0; j < F.cols(); j++)
+        m_col_start[j + 1] += m_col_start[j];
 }
 
 SparseSideInfo::~SparseSideInfo() {}
@@ -27,6 +35,11 @@ int SparseSideInfo::rows() const
    return F.rows();
 }
 
+std::uint64_t SparseSideInfo::nnz() const
+{
+   return F.nonZeros();
+}
+
 std::ostream& SparseSideInfo::print(std::ostream &os) const
 {
    double percent = 100.8 * (double)F.nonZeros() / (double)F.rows() / (double) F.cols();
@@ -43,13 +56,84 @@ bool SparseSideInfo::is_dense() const
 void SparseSideInfo::compute_uhat(Eigen::MatrixXd& uhat, Eigen::MatrixXd& beta)
 {
     COUNTER("compute_uhat");
-    uhat = beta * (Ft);
+    uhat = beta * F.transpose();
 }
 
+// the upper triangle of At_mul_A_block is copied from the lower one in tiles of this size
+static const int ATA_MIRROR_TILE = 64;
+
+// ranges of output columns per thread in At_mul_A_block
+static const int ATA_RANGES_PER_THREAD = 4;
+
 void SparseSideInfo::At_mul_A(Eigen::MatrixXd& out)
 {
     COUNTER("At_mul_A");
-    out = Ft * F;
+    At_mul_A_block(out, 0, F.cols());
+}
+
+// F(:, col:col+n)' * F(:, col:col+n) as a sparse SYRK straight into the dense
+// output: column j of the lower triangle is the sum over the nonzeros F(i, j)
+// of F(i, j) * F(i, j:col+n). Only the rows of F are used, so the column-major
+// copy is not built. The output columns are split into ranges of about the
+// same work, each range scans all rows and finds its nonzeros with a binary
+// search (the rows of F are sorted), so every range owns its output columns
+// and there are no write conflicts.
+void SparseSideInfo::At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols)
+{
+    THROWERROR_ASSERT_MSG(col >= 0 && ncols >= 0 && col + ncols <= F.cols(), "column range out of range");
+
+    const int n = ncols;
+    const int last = col + n;
+    const int nrows = F.rows();
+    out.resize(n, n);
+
+    const int* row_ptr = F.outerIndexPtr();
+    const int* row_cols = F.innerIndexPtr();
+    const double* row_values = F.valuePtr();
+
+    // column col + j adds about nnz(F(:, col + j)) * (n - j) / n rows of average length
+    std::vector<double> cost(n + 1, 0.0);
+    for (int j = 0; j < n; j++)
+        cost[j + 1] = cost[j] + (double)(m_col_start[col + j + 1] - m_col_start[col + j]) * (n - j);
+
+    const int nranges = std::max(1, std::min(threads::get_max_threads() * ATA_RANGES_PER_THREAD, n));
+    std::vector<int> start(nranges + 1);
+    for (int k = 0; k <= nranges; k++)
+        start[k] = std::lower_bound(cost.begin(), cost.end() - 1, cost[n] * k / nranges) - cost.begin();
+    start[nranges] = n;
+
+    threads::parallel_for(0, nranges, [&](std::int64_t r)
+    {
+        const int j0 = start[r];
+        const int j1 = start[r + 1];
+        for (int j = j0; j < j1; j++)
+            std::fill(out.data() + (std::int64_t)j * n + j, out.data() + (std::int64_t)(j + 1) * n, 0.0);
+        if (j0 == j1)
+            return;
+
+        for (int i = 0; i < nrows; i++)
+        {
+            const int* end = row_cols + row_ptr[i + 1];
+            for (const int* c = std::lower_bound(row_cols + row_ptr[i], end, col + j0); c < end && *c < col + j1; c++)
+            {
+                const double v = row_values[c - row_cols];
+                double* out_j = out.data() + (std::int64_t)(*c - col) * n;
+                for (const int* k = c; k < end && *k < last; k++)
+                    out_j[*k - col] += v * row_values[k - row_cols];
+            }
+        }
+    });
+
+    const int ntiles = (n + ATA_MIRROR_TILE - 1) / ATA_MIRROR_TILE;
+    threads::parallel_for(0, ntiles, [&](std::int64_t t)
+    {
+        const int j0 = t * ATA_MIRROR_TILE;
+        const int j1 = std::min(n, j0 + ATA_MIRROR_TILE);
+        for (int k0 = 0; k0 <= j0; k0 += ATA_MIRROR_TILE)
+            for (int j = j0; j < j1; j++)
+                for (int k = k0; k < std::min(j, k0 + ATA_MIRROR_TILE); k++)
+                    out(k, j) = out(j, k);
+    });
 }
 
 Eigen::MatrixXd SparseSideInfo::A_mul_B(Eigen::MatrixXd& A)
@@ -58,10 +142,76 @@ Eigen::MatrixXd SparseSideInfo::A_mul_B(Eigen::MatrixXd& A)
     return (A * F);
 }
 
-int SparseSideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error)
+// Two passes over the rows of F without partial results:
+//  - T(:, i) = B * F(i, :)', by blocks of rows
+//  - out(:, j) = sum over the nonzeros F(i, j) of F(i, j) * T(:, i), each
+//    thread owns a range of output columns with about the same number of
+//    nonzeros and finds its part of every row with a binary search (the rows
+//    of F are sorted), like At_mul_A
+void SparseSideInfo::AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const
+{
+    const int nrhs = B.rows();
+    const int nfeat = B.cols();
+    const int nrows = F.rows();
+
+    THROWERROR_ASSERT_MSG(nfeat == F.cols(), "B.cols() must equal F.cols()");
+
+    const int *outer = F.outerIndexPtr();
+    const int *inner = F.innerIndexPtr();
+    const double *values = F.valuePtr();
+
+    Eigen::MatrixXd T(nrhs, nrows);
+    threads::parallel_for_blocks(0, nrows, [&](std::int64_t from, std::int64_t to)
+    {
+        for (std::int64_t i = from; i < to; i++)
+        {
+            double *t = T.data() + i * nrhs;
+            std::fill(t, t + nrhs, 0.0);
+            for (int p = outer[i]; p < outer[i + 1]; p++)
+            {
+                const double v = values[p];
+                const double *b = B.data() + (std::int64_t)inner[p] * nrhs;
+                for (int r = 0; r < nrhs; r++) t[r] += v * b[r];
+            }
+        }
+    });
+
+    const int nranges = std::max(1, std::min(threads::get_max_threads(), nfeat));
+    std::vector<int> start(nranges + 1);
+    for (int k = 0; k <= nranges; k++)
+    {
+        const std::int64_t nnz = (std::int64_t)F.nonZeros() * k / nranges;
+        start[k] = std::lower_bound(m_col_start.begin(), m_col_start.end() - 1, nnz) - m_col_start.begin();
+    }
+    start[nranges] = nfeat;
+
+    out.resize(nrhs, nfeat);
+    threads::parallel_for(0, nranges, [&](std::int64_t k)
+    {
+        const int f0 = start[k];
+        const int f1 = start[k + 1];
+        if (f0 == f1)
+            return;
+
+        out.middleCols(f0, f1 - f0) = reg * B.middleCols(f0, f1 - f0);
+        for (int i = 0; i < nrows; i++)
+        {
+            const int *end = inner + outer[i + 1];
+            const double *t = T.data() + (std::int64_t)i * nrhs;
+            for (const int *c = std::lower_bound(inner + outer[i], end, f0); c < end && *c < f1; c++)
+            {
+                const double v = values[c - inner];
+                double *o = out.data() + (std::int64_t)*c * nrhs;
+                for (int r = 0; r < nrhs; r++) o[r] += v * t[r];
+            }
+        }
+    });
+}
+
+int SparseSideInfo::solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error, bool warm_start, const linop::Preconditioner *precond)
 {
     COUNTER("solve_blockcg");
-    return smurff::linop::solve_blockcg(X, *this, reg, B, tol, blocksize, excess, throw_on_cholesky_error);
+    return smurff::linop::solve_blockcg(X, *this, reg, B, tol, blocksize, excess, throw_on_cholesky_error, warm_start, precond);
 #if 0
     int iter1, iter2;
     Eigen::MatrixXd X1 = X;
@@ -104,13 +254,64 @@ Eigen::VectorXd SparseSideInfo::col_square_sum()
 void SparseSideInfo::At_mul_Bt(Eigen::VectorXd& Y, const int col, Eigen::MatrixXd& B)
 {
     COUNTER("At_mul_Bt");
-    auto out = Ft.block(col, 0, col + 1, Ft.cols()) * B.transpose();
-    Y = out.transpose();
+    Y = B * F_colmajor().col(col);
 }
 
 // computes Z += A[:,col] * b', where a and b are vectors
 void SparseSideInfo::add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b)
 {
     COUNTER("add_Acol_mul_bt");
-    Z += (F.col(col) * b.transpose()).transpose();
+    Z += (F_colmajor().col(col) * b.transpose()).transpose();
+}
+
+// column_sweep for a Z with W rows: reads the CSC arrays directly, the W sums
+// stay in registers and Z is updated in place, Z(:, i) is contiguous
+template<int W>
+static void column_sweep_csc(const Eigen::SparseMatrix<double>& A, Eigen::MatrixXd& Z, const ISideInfo::ColumnUpdate& update)
+{
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    const double* values = A.valuePtr();
+    double* z = Z.data();
+
+    Eigen::VectorXd zx(W), b(W);
+    for (int col = 0; col < A.cols(); col++)
+    {
+        double t[W];
+        for (int w = 0; w < W; w++) t[w] = 0.0;
+        for (int p = outer[col]; p < outer[col + 1]; p++)
+        {
+            const double *zi = z + (std::int64_t)inner[p] * W;
+            for (int w = 0; w < W; w++) t[w] += values[p] * zi[w];
+        }
+        for (int w = 0; w < W; w++) zx(w) = t[w];
+
+        update(col, zx, b);
+
+        for (int w = 0; w < W; w++) t[w] = b(w);
+        for (int p = outer[col]; p < outer[col + 1]; p++)
+        {
+            double *zi = z + (std::int64_t)inner[p] * W;
+            for (int w = 0; w < W; w++) zi[w] += values[p] * t[w];
+        }
+    }
+}
+
+void SparseSideInfo::column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update)
+{
+    COUNTER("column_sweep");
+    switch (Z.rows())
+    {
+    case 1: column_sweep_csc<1>(F_colmajor(), Z, update); break;
+    case 2: column_sweep_csc<2>(F_colmajor(), Z, update); break;
+    case 3: column_sweep_csc<3>(F_colmajor(), Z, update); break;
+    case 4: column_sweep_csc<4>(F_colmajor(), Z, update); break;
+    default: ISideInfo::column_sweep(Z, update);
+    }
+}
+
+const Eigen::SparseMatrix<double>& SparseSideInfo::F_colmajor()
+{
+    std::call_once(m_F_colmajor_once, [this]() { m_F_colmajor = F; m_F_colmajor.makeCompressed(); });
+    return m_F_colmajor;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <Eigen/Sparse>
 #include <SmurffCpp/Configs/MatrixConfig.h>
 
@@ -12,9 +14,21 @@ class SparseSideInfo : public ISideInfo
 {
 
 public:
-   Eigen::SparseMatrix<double> F;
-   Eigen::SparseMatrix<double> Ft;
+   // only the row-major (CSR) copy of the features is kept, the column-major
+   // copy is built on first use by the methods that walk single columns:
+   // At_mul_Bt, add_Acol_mul_bt and column_sweep
+   Eigen::SparseMatrix<double, Eigen::RowMajor> F;
 
+private:
+   Eigen::SparseMatrix<double> m_F_colmajor;
+   std::once_flag m_F_colmajor_once;
+
+   const Eigen::SparseMatrix<double>& F_colmajor();
+
+   // number of nonzeros of F left of column j, F.cols() + 1 entries
+   std::vector<std::int64_t> m_col_start;
+
+public:
    SparseSideInfo(const std::shared_ptr<MatrixConfig> &);
    ~SparseSideInfo() override;
 
@@ -22,6 +36,8 @@ public:
    int cols() const override;
    int rows() const override;
 
+   std::uint64_t nnz() const override;
+
 public:
    std::ostream& print(std::ostream &os) const override;
    
@@ -34,9 +50,15 @@ public:
 
    void At_mul_A(Eigen::MatrixXd& out) override;
 
+   void At_mul_A_block(Eigen::MatrixXd& out, int col, int ncols) override;
+
    Eigen::MatrixXd A_mul_B(Eigen::MatrixXd& A) override;
 
-   int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false) override;
+   // out = (F' * F * B' + reg * B')', without partial results
+   // per thread, the output columns are split over the threads
+   void AtA_mul_B(Eigen::MatrixXd& out, double reg, const Eigen::MatrixXd& B) const;
+
+   int solve_blockcg(Eigen::MatrixXd& X, double reg, Eigen::MatrixXd& B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const linop::Preconditioner *precond = nullptr) override;
 
    Eigen::VectorXd col_square_sum() override;
 
@@ -44,6 +66,9 @@ public:
 
    void add_Acol_mul_bt(Eigen::MatrixXd& Z, const int col, Eigen::VectorXd& b) override;
 
+
+   void column_sweep(Eigen::MatrixXd& Z, const ColumnUpdate& update) override;
+
 };
 
 }
@@ -0,0 +1,161 @@
+#include "BatchCholesky.h"
+
+#include <cmath>
+
+#include <SmurffCpp/Utils/Error.h>
+
+using namespace smurff;
+
+BatchCholesky::BatchCholesky(int K)
+   : m_K(0), m_count(0)
+{
+   resize(K);
+}
+
+void BatchCholesky::resize(int K)
+{
+   m_K = K;
+   m_count = 0;
+   m_A.assign(K * K * BATCH_SIZE, 0.0);
+   m_x.assign(K * BATCH_SIZE, 0.0);
+}
+
+void BatchCholesky::clear()
+{
+   m_count = 0;
+}
+
+int BatchCholesky::add(const Eigen::MatrixXd& MM, const Eigen::VectorXd& rr)
+{
+   THROWERROR_ASSERT_MSG(m_count < BATCH_SIZE, "Batch is full");
+   THROWERROR_ASSERT(MM.rows() == m_K && MM.cols() == m_K && rr.size() == m_K);
+
+   const int K = m_K;
+   const int b = m_count++;
+
+   for (int j = 0; j < K; ++j)
+      for (int i = j; i < K; ++i)
+         m_A[(i * K + j) * BATCH_SIZE + b] = MM(i, j);
+
+   for (int i = 0; i < K; ++i)
+      m_x[i * BATCH_SIZE + b] = rr(i);
+
+   return b;
+}
+
+bool BatchCholesky::factorize()
+{
+   const int K = m_K;
+   const int B = BATCH_SIZE;
+   double *A = m_A.data();
+
+   // unused slots get an identity system so they cannot fail
+   for (int b = m_count; b < B; ++b)
+   {
+      for (int j = 0; j < K; ++j)
+         for (int i = j; i < K; ++i)
+            A[(i * K + j) * B + b] = (i == j) ? 1.0 : 0.0;
+
+      for (int i = 0; i < K; ++i)
+         m_x[i * B + b] = 0.0;
+   }
+
+   double inv_diag[B];
+
+   for (int j = 0; j < K; ++j)
+   {
+      double *Ajj = A + (j * K + j) * B;
+      for (int k = 0; k < j; ++k)
+      {
+         const double *Ljk = A + (j * K + k) * B;
+         for (int b = 0; b < B; ++b)
+            Ajj[b] -= Ljk[b] * Ljk[b];
+      }
+
+      bool positive = true;
+      for (int b = 0; b < B; ++b)
+         positive &= Ajj[b] > 0.0;
+
+      if (!positive)
+         return false;
+
+      for (int b = 0; b < B; ++b)
+      {
+         Ajj[b] = std::sqrt(Ajj[b]);
+         inv_diag[b] = 1.0 / Ajj[b];
+      }
+
+      for (int i = j + 1; i < K; ++i)
+      {
+         double *Aij = A + (i * K + j) * B;
+         for (int k = 0; k < j; ++k)
+         {
+            const double *Lik = A + (i * K + k) * B;
+            const double *Ljk = A + (j * K + k) * B;
+            for (int b = 0; b < B; ++b)
+               Aij[b] -= Lik[b] * Ljk[b];
+         }
+
+         for (int b = 0; b < B; ++b)
+            Aij[b] *= inv_diag[b];
+      }
+   }
+
+   return true;
+}
+
+void BatchCholesky::solveL()
+{
+   const int K = m_K;
+   const int B = BATCH_SIZE;
+   const double *L = m_A.data();
+   double *x = m_x.data();
+
+   for (int i = 0; i < K; ++i)
+   {
+      double *xi = x + i * B;
+      for (int k = 0; k < i; ++k)
+      {
+         const double *Lik = L + (i * K + k) * B;
+         const double *xk = x + k * B;
+         for (int b = 0; b < B; ++b)
+            xi[b] -= Lik[b] * xk[b];
+      }
+
+      const double *Lii = L + (i * K + i) * B;
+      for (int b = 0; b < B; ++b)
+         xi[b] /= Lii[b];
+   }
+}
+
+void BatchCholesky::solveLt()
+{
+   const int K = m_K;
+   const int B = BATCH_SIZE;
+   const double *L = m_A.data();
+   double *x = m_x.data();
+
+   for (int i = K - 1; i >= 0; --i)
+   {
+      double *xi = x + i * B;
+      for (int k = i + 1; k < K; ++k)
+      {
+         const double *Lki = L + (k * K + i) * B;
+         const double *xk = x + k * B;
+         for (int b = 0; b < B; ++b)
+            xi[b] -= Lki[b] * xk[b];
+      }
+
+      const double *Lii = L + (i * K + i) * B;
+      for (int b = 0; b < B; ++b)
+         xi[b] /= Lii[b];
+   }
+}
+
+void BatchCholesky::add_rhs(int b, const Eigen::VectorXd& v)
+{
+   THROWERROR_ASSERT(b < m_count && v.size() == m_K);
+
+   for (int i = 0; i < m_K; ++i)
+      m_x[i * BATCH_SIZE + b] += v(i);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace smurff {
+
+// Cholesky factorization and triangular solves for a small batch of
+// symmetric positive definite K x K systems.
+//
+// Systems are stored interleaved: entry (i,j) of system b lives at
+// (i * K + j) * BATCH_SIZE + b. All inner loops therefore run over the
+// batch with unit stride, which the compiler vectorizes, instead of over
+// K-sized rows that are too short to amortize the per-system overhead.
+class BatchCholesky
+{
+public:
+   static const int BATCH_SIZE = 8;
+
+private:
+   int m_K;
+   int m_count;
+
+   std::vector<double> m_A; // K x K x BATCH_SIZE, only the lower triangle is used
+   std::vector<double> m_x; // K x BATCH_SIZE right-hand sides / solutions
+
+public:
+   BatchCholesky(int K = 0);
+
+   void resize(int K);
+
+   int num_latent() const { return m_K; }
+   int size() const { return m_count; }
+   bool full() const { return m_count == BATCH_SIZE; }
+
+   // remove all systems from the batch
+   void clear();
+
+   // append system MM * x = rr, returns its slot in the batch
+   // only the lower triangle of MM is read
+   int add(const Eigen::MatrixXd& MM, const Eigen::VectorXd& rr);
+
+   // in place factorization MM = L * L^T of every system in the batch
+   // returns false if one of the systems is not positive definite
+   bool factorize();
+
+   // x = L^-1 * x
+   void solveL();
+
+   // x = L^-T * x
+   void solveLt();
+
+   // x += v for system in slot b
+   void add_rhs(int b, const Eigen::VectorXd& v);
+
+   // copy x of system in slot b into out
+   template<typename Out>
+   void get(int b, Out&& out) const
+   {
+      for (int i = 0; i < m_K; ++i)
+         out(i) = m_x[i * BATCH_SIZE + b];
+   }
+};
+
+}
@@ -30,75 +30,145 @@
 using namespace Eigen;
 
 static smurff::thread_vector<MERSENNE_TWISTER> *bmrngs;
+static smurff::thread_vector<smurff::Philox4x32> *philox_rngs;
+static bool use_counter_based = false;
+static int rng_seed = 0;
+static int rng_iteration = 0;
+
+// bmrandn with the counter based generator splits its output in chunks
+// of BMRANDN_CHUNK pairs, pair i is block i after the caller's position,
+// whatever thread its chunk runs on
+static const long BMRANDN_CHUNK = 1024;
+
+static const std::uint32_t PHILOX_M0 = 0xD2511F53;
+static const std::uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const std::uint32_t PHILOX_W0 = 0x9E3779B9;
+static const std::uint32_t PHILOX_W1 = 0xBB67AE85;
+
+smurff::Philox4x32::Philox4x32(std::uint32_t seed)
+{
+   m_key[0] = seed;
+   m_key[1] = 0;
+   select(0, -1, -1, 0);
+}
 
-double smurff::randn0()
+void smurff::Philox4x32::select(int iteration, int mode, int item, int sub)
 {
-   return smurff::bmrandn_single_thread();
+   m_ctr[0] = 0;
+   m_ctr[1] = (std::uint32_t)item;
+   m_ctr[2] = ((std::uint32_t)(mode & 0xff) << 24) | ((std::uint32_t)sub & 0xffffff);
+   m_ctr[3] = (std::uint32_t)iteration;
+   m_pos = 4;
 }
 
-double smurff::randn(double) 
+void smurff::Philox4x32::skip(std::uint32_t n)
 {
-   return smurff::bmrandn_single_thread();
+   m_ctr[0] += n;
+   m_pos = 4;
 }
 
-void smurff::bmrandn(double* x, long n) 
+smurff::Philox4x32::result_type smurff::Philox4x32::operator()()
 {
-   #pragma omp parallel 
+   if (m_pos == 4)
    {
-      UNIFORM_REAL_DISTRIBUTION unif(-1.0, 1.0);
-      auto& bmrng = bmrngs->local();
-      
-      #pragma omp for schedule(static)
-      for (long i = 0; i < n; i += 2) 
-      {
-         double x1, x2, w;
-         do 
-         {
-           x1 = unif(bmrng);
-           x2 = unif(bmrng);
-           w = x1 * x1 + x2 * x2;
-         } while ( w >= 1.0 );
-   
-         w = std::sqrt( (-2.0 * std::log( w ) ) / w );
-         x[i] = x1 * w;
+      generate(m_ctr, m_key, m_out);
+      m_ctr[0]++;
+      m_pos = 0;
+   }
+   return m_out[m_pos++];
+}
 
-         if (i + 1 < n) 
-         {
-           x[i+1] = x2 * w;
-         }
+// the 10 rounds for m counters at once, stored as four arrays of words
+// (structure of arrays, the inner loop over the counters vectorizes)
+static void philox_rounds(std::uint32_t *c0, std::uint32_t *c1, std::uint32_t *c2, std::uint32_t *c3, const std::uint32_t key[2], long m)
+{
+   std::uint32_t k0 = key[0], k1 = key[1];
+
+   for (int r = 0; r < 10; r++)
+   {
+      for (long i = 0; i < m; i++)
+      {
+         const std::uint64_t p0 = (std::uint64_t)PHILOX_M0 * c0[i];
+         const std::uint64_t p1 = (std::uint64_t)PHILOX_M1 * c2[i];
+         const std::uint32_t n0 = (std::uint32_t)(p1 >> 32) ^ c1[i] ^ k0;
+         const std::uint32_t n2 = (std::uint32_t)(p0 >> 32) ^ c3[i] ^ k1;
+         c1[i] = (std::uint32_t)p1;
+         c3[i] = (std::uint32_t)p0;
+         c0[i] = n0;
+         c2[i] = n2;
       }
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
    }
 }
-   
-void smurff::bmrandn(Eigen::MatrixXd & X) 
+
+void smurff::Philox4x32::generate(const std::uint32_t ctr[4], const std::uint32_t key[2], std::uint32_t out[4])
 {
-   long n = X.rows() * (long)X.cols();
-   smurff::bmrandn(X.data(), n);
+   out[0] = ctr[0]; out[1] = ctr[1]; out[2] = ctr[2]; out[3] = ctr[3];
+   philox_rounds(out, out + 1, out + 2, out + 3, key, 1);
 }
 
-double smurff::bmrandn_single_thread() 
+// bulk Box-Muller: pair i comes from block i without rejection step, the
+// random words, the uniforms and the transform are computed in separate
+// loops over a tile so each of them can be vectorized
+void smurff::Philox4x32::normals(double *x, long n)
 {
-   //TODO: add bmrng as input
-   UNIFORM_REAL_DISTRIBUTION unif(-1.0, 1.0);
-   auto& bmrng = bmrngs->local();
-  
-   double x1, x2, w;
-   do 
+   const long TILE = 256;
+   const long npairs = (n + 1) / 2;
+   const double two_pi = 6.283185307179586476925286766559;
+   const double to_unit = 1.0 / 9007199254740992.0; // 2^-53
+
+   std::uint32_t c0[TILE], c1[TILE], c2[TILE], c3[TILE];
+   double u1[TILE], u2[TILE], z1[TILE], z2[TILE];
+
+   for (long p = 0; p < npairs; p += TILE)
    {
-      x1 = unif(bmrng);
-      x2 = unif(bmrng);
-      w = x1 * x1 + x2 * x2;
-   } while ( w >= 1.0 );
+      const long m = std::min(TILE, npairs - p);
 
-   w = std::sqrt( (-2.0 * std::log( w ) ) / w );
-   return x1 * w;
+      for (long i = 0; i < m; i++)
+      {
+         c0[i] = m_ctr[0] + (std::uint32_t)(p + i);
+         c1[i] = m_ctr[1];
+         c2[i] = m_ctr[2];
+         c3[i] = m_ctr[3];
+      }
+
+      philox_rounds(c0, c1, c2, c3, m_key, m);
+
+      // two 53 bit uniforms per block, u1 in (0, 1] for the log
+      for (long i = 0; i < m; i++)
+      {
+         u1[i] = 1.0 - ((c0[i] >> 5) * 67108864.0 + (c1[i] >> 6)) * to_unit;
+         u2[i] = ((c2[i] >> 5) * 67108864.0 + (c3[i] >> 6)) * to_unit;
+      }
+
+      for (long i = 0; i < m; i++)
+      {
+         const double r = std::sqrt(-2.0 * std::log(u1[i]));
+         const double t = two_pi * u2[i];
+         z1[i] = r * std::cos(t);
+         z2[i] = r * std::sin(t);
+      }
+
+      double *xp = x + 2 * p;
+      const long len = std::min(2 * m, n - 2 * p);
+      for (long i = 0; i < len / 2; i++)
+      {
+         xp[2 * i] = z1[i];
+         xp[2 * i + 1] = z2[i];
+      }
+      if (len % 2)
+         xp[len - 1] = z1[len / 2];
+   }
+
+   skip(npairs);
 }
 
-// to be called within OpenMP parallel loop (also from serial code is fine)
-void smurff::bmrandn_single_thread(double* x, long n) 
+// polar Box-Muller, fills x[0 .. n) from rng
+template<typename Engine>
+static void bmrandn_fill(Engine &rng, double* x, long n)
 {
    UNIFORM_REAL_DISTRIBUTION unif(-1.0, 1.0);
-   auto& bmrng = bmrngs->local();
 
    for (long i = 0; i < n; i += 2) 
    {
@@ -106,8 +176,8 @@ void smurff::bmrandn_single_thread(double* x, long n)
 
       do 
       {
-         x1 = unif(bmrng);
-         x2 = unif(bmrng);
+         x1 = unif(rng);
+         x2 = unif(rng);
          w = x1 * x1 + x2 * x2;
       } while ( w >= 1.0 );
  
@@ -120,6 +190,88 @@ void smurff::bmrandn_single_thread(double* x, long n)
       }
    }
 }
+
+template<typename Engine>
+static double bmrandn_one(Engine &rng)
+{
+   UNIFORM_REAL_DISTRIBUTION unif(-1.0, 1.0);
+
+   double x1, x2, w;
+   do 
+   {
+      x1 = unif(rng);
+      x2 = unif(rng);
+      w = x1 * x1 + x2 * x2;
+   } while ( w >= 1.0 );
+
+   w = std::sqrt( (-2.0 * std::log( w ) ) / w );
+   return x1 * w;
+}
+
+double smurff::randn0()
+{
+   return smurff::bmrandn_single_thread();
+}
+
+double smurff::randn(double) 
+{
+   return smurff::bmrandn_single_thread();
+}
+
+void smurff::bmrandn(double* x, long n) 
+{
+   if (use_counter_based)
+   {
+      // same numbers as philox_rngs->local().normals(x, n), in parallel
+      Philox4x32 &caller = philox_rngs->local();
+      const Philox4x32 start = caller;
+      const long num_chunks = (n + 2 * BMRANDN_CHUNK - 1) / (2 * BMRANDN_CHUNK);
+      caller.skip((n + 1) / 2);
+
+      smurff::threads::parallel_for(0, num_chunks, [x, n, &start](std::int64_t c)
+      {
+         Philox4x32 rng = start;
+         rng.skip(c * BMRANDN_CHUNK);
+         const long from = c * 2 * BMRANDN_CHUNK;
+         rng.normals(x + from, std::min(n - from, 2 * BMRANDN_CHUNK));
+      });
+      return;
+   }
+
+   // one block of pairs per thread, each thread draws from its own generator
+   smurff::threads::parallel_for_static(0, (n + 1) / 2, [x, n](std::int64_t from, std::int64_t to)
+   {
+      bmrandn_fill(bmrngs->local(), x + 2 * from, std::min<long>(n, 2 * to) - 2 * from);
+   });
+}
+   
+void smurff::bmrandn(Eigen::MatrixXd & X) 
+{
+   long n = X.rows() * (long)X.cols();
+   smurff::bmrandn(X.data(), n);
+}
+
+double smurff::bmrandn_single_thread() 
+{
+   //TODO: add bmrng as input
+   if (use_counter_based)
+   {
+      double x;
+      philox_rngs->local().normals(&x, 1);
+      return x;
+   }
+
+   return bmrandn_one(bmrngs->local());
+}
+
+// to be called within OpenMP parallel loop (also from serial code is fine)
+void smurff::bmrandn_single_thread(double* x, long n) 
+{
+   if (use_counter_based)
+      philox_rngs->local().normals(x, n);
+   else
+      bmrandn_fill(bmrngs->local(), x, n);
+}
   
 void smurff::bmrandn_single_thread(Eigen::VectorXd & x) 
 {
@@ -133,36 +285,77 @@ void smurff::bmrandn_single_thread(Eigen::MatrixXd & X)
 }
 
 
-void smurff::init_bmrng() 
+void smurff::init_bmrng(bool counter_based) 
 {
    using namespace std::chrono;
    auto ms = (duration_cast< milliseconds >(system_clock::now().time_since_epoch())).count();
-   smurff::init_bmrng(ms);
+   smurff::init_bmrng(ms, counter_based);
 }
 
-void smurff::init_bmrng(int seed) 
+void smurff::init_bmrng(int seed, bool counter_based) 
 {
     std::vector<MERSENNE_TWISTER> v;
+    std::vector<Philox4x32> p;
     for (int i = 0; i < threads::get_max_threads(); i++)
     {
         v.push_back(MERSENNE_TWISTER(seed + i * 1999));
+        p.push_back(Philox4x32(seed));
     }
     bmrngs = new smurff::thread_vector<MERSENNE_TWISTER>();
     bmrngs->init(v);
+    philox_rngs = new smurff::thread_vector<Philox4x32>();
+    philox_rngs->init(p);
+
+    use_counter_based = counter_based;
+    rng_seed = seed;
+    rng_iteration = 0;
+}
+
+void smurff::set_rng_iteration(int iteration)
+{
+   if (!use_counter_based)
+      return;
+
+   rng_iteration = iteration;
+
+   Philox4x32 rng(rng_seed);
+   rng.select(iteration, -1, -1, 0);
+   philox_rngs->init(std::vector<Philox4x32>(threads::get_max_threads(), rng));
+}
+
+void smurff::select_rng_stream(int mode, int item, int sub)
+{
+   if (use_counter_based)
+      philox_rngs->local().select(rng_iteration, mode, item, sub);
+}
+
+smurff::Philox4x32 smurff::get_rng_stream()
+{
+   return use_counter_based ? philox_rngs->local() : Philox4x32();
+}
+
+void smurff::set_rng_stream(const Philox4x32 &stream)
+{
+   if (use_counter_based)
+      philox_rngs->local() = stream;
 }
    
 double smurff::rand_unif() 
 {
    UNIFORM_REAL_DISTRIBUTION unif(0.0, 1.0);
-   auto& bmrng = bmrngs->local();
-   return unif(bmrng);
+   if (use_counter_based)
+      return unif(philox_rngs->local());
+   else
+      return unif(bmrngs->local());
 }
  
 double smurff::rand_unif(double low, double high) 
 {
    UNIFORM_REAL_DISTRIBUTION unif(low, high);
-   auto& bmrng = bmrngs->local();
-   return unif(bmrng);
+   if (use_counter_based)
+      return unif(philox_rngs->local());
+   else
+      return unif(bmrngs->local());
 }
 
 // returns random number according to Gamma distribution
@@ -170,12 +363,20 @@ double smurff::rand_unif(double low, double high)
 double smurff::rgamma(double shape, double scale) 
 {
    GAMMA_DISTRIBUTION gamma(shape, scale);
-   return gamma(bmrngs->local());
+   if (use_counter_based)
+      return gamma(philox_rngs->local());
+   else
+      return gamma(bmrngs->local());
 }
 
-auto smurff::nrandn(int n) -> decltype(Eigen::VectorXd::NullaryExpr(n, std::cref(randn))) 
+Eigen::VectorXd smurff::nrandn(int n)
 {
-   return Eigen::VectorXd::NullaryExpr(n, std::cref(randn));
+   Eigen::VectorXd x(n);
+   if (use_counter_based)
+      philox_rngs->local().normals(x.data(), n);
+   else
+      x = Eigen::VectorXd::NullaryExpr(n, std::cref(randn));
+   return x;
 }
 
 auto smurff::nrandn(int n, int m) -> decltype(Eigen::ArrayXXd::NullaryExpr(n, m, std::ptr_fun(randn)))
@@ -188,12 +389,10 @@ Eigen::MatrixXd WishartUnit(int m, int df)
 {
    Eigen::MatrixXd c(m,m);
    c.setZero();
-   auto& rng = bmrngs->local();
 
    for ( int i = 0; i < m; i++ ) 
    {
-      GAMMA_DISTRIBUTION gam(0.5*(df - i));
-      c(i,i) = std::sqrt(2.0 * gam(rng));
+      c(i,i) = std::sqrt(2.0 * smurff::rgamma(0.5*(df - i), 1.0));
       Eigen::VectorXd r = smurff::nrandn(m-i-1);
       c.block(i,i+1,1,m-i-1) = r.transpose();
    }
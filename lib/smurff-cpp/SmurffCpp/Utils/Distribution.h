@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <map>
 
 #include <Eigen/Dense>
@@ -18,8 +20,56 @@ namespace smurff
    void bmrandn_single_thread(Eigen::VectorXd & x);
    void bmrandn_single_thread(Eigen::MatrixXd & X);
    
-   void init_bmrng();
-   void init_bmrng(int seed);
+   void init_bmrng(bool counter_based = false);
+   void init_bmrng(int seed, bool counter_based = false);
+
+   // Philox4x32-10 counter based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+   //
+   // Used instead of one mt19937 per thread when init_bmrng is called with counter_based = true.
+   // The 128 bit counter is (block, item, mode << 24 | sub, iteration), the key is the seed.
+   // Every item draws from its own streams, so the random numbers do not depend on which
+   // thread samples an item, nor on the number of threads. Sums over the threads are
+   // still rounded differently for different numbers of threads.
+   class Philox4x32
+   {
+   public:
+      typedef std::uint32_t result_type;
+
+      static constexpr result_type min() { return 0; }
+      static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+      Philox4x32(std::uint32_t seed = 0);
+
+      // restart at block 0 of stream (mode, item, sub) of the given iteration
+      void select(int iteration, int mode, int item, int sub);
+
+      // skip to the start of the n-th next block
+      void skip(std::uint32_t n);
+
+      result_type operator()();
+
+      // n normals from the next (n + 1) / 2 blocks, one pair per block (Box-Muller)
+      void normals(double *x, long n);
+
+      // one Philox4x32-10 bijection: 4 random words out of counter ctr and key
+      static void generate(const std::uint32_t ctr[4], const std::uint32_t key[2], std::uint32_t out[4]);
+
+   private:
+      std::uint32_t m_key[2];
+      std::uint32_t m_ctr[4];
+      std::uint32_t m_out[4];
+      int m_pos;
+   };
+
+   // counter based generator only, no-ops for mt19937:
+   //  - set_rng_iteration: start a new Gibbs iteration, each thread goes back to the default stream
+   //  - select_rng_stream: draw the next numbers of this thread from stream (mode, item, sub),
+   //    item -1 is for the hyper parameters of a mode, mode -1 for what is not part of a mode
+   //  - get/set_rng_stream: save and restore the position of this thread in its stream
+   void set_rng_iteration(int iteration);
+   void select_rng_stream(int mode, int item, int sub = 0);
+   Philox4x32 get_rng_stream();
+   void set_rng_stream(const Philox4x32 &stream);
    
    double rand_unif();
    double rand_unif(double low, double high);
@@ -28,7 +78,7 @@ namespace smurff
    
    // return a random matrix of size n, m
    
-   auto nrandn(int n) -> decltype(Eigen::VectorXd::NullaryExpr(n, std::cref(randn)) ); 
+   Eigen::VectorXd nrandn(int n);
    auto nrandn(int n, int m) -> decltype(Eigen::ArrayXXd::NullaryExpr(n, m, std::ptr_fun(randn)) );
    
    // Wishart distribution
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace smurff {
+
+// The hot loop of the Gibbs sampler (NormalPrior::sample_latent,
+// ScarceMatrixData::getMuLambda and Model::predict) has kernels with
+// compile-time fixed size Eigen types for these values of num_latent.
+// This allows the compiler to fully unroll and vectorize the rank-1
+// updates, the K x K Cholesky and the dot products.
+// All other values of num_latent use Eigen::MatrixXd / Eigen::VectorXd.
+// Larger sizes are not worth it: the K x K matrices and their Cholesky
+// factor live on the stack of the worker threads (about 64 KB for K = 64).
+// Only Model::predict, which needs no K x K matrix, also has a K = 64 case.
+//
+// Sites that specialise dispatch with a switch on num_latent:
+//
+//    switch(num_latent)
+//    {
+//       case 8:  return kernel<8>(...);
+//       case 16: return kernel<16>(...);
+//       case 32: return kernel<32>(...);
+//       default: return dynamic_kernel(...);
+//    }
+
+inline bool is_fixed_num_latent(int num_latent)
+{
+   switch(num_latent)
+   {
+      case 8:
+      case 16:
+      case 32:
+         return true;
+      default:
+         return false;
+   }
+}
+
+}
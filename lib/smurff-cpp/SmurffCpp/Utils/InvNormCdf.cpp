@@ -211,3 +211,23 @@ double inv_norm_cdf(double y0)
     x = -x;
   return (x);
 }
+
+/* Batched version: the central region 0.135 < y <= 0.865, which holds most
+ * samples, is evaluated for all values in one loop without branches, the
+ * tails are then redone with the scalar version.
+ */
+void inv_norm_cdf(int n, const double *y, double *x)
+{
+  const double e2 = 0.13533528323661269189; /* exp(-2) */
+
+  for (int i = 0; i < n; i++) {
+    double w = y[i] - 0.5;
+    double w2 = w * w;
+    x[i] = (w + w * (w2 * polevl(w2, P0, 4) / p1evl(w2, Q0, 8))) * s2pi;
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (!(y[i] > e2 && y[i] <= 1.0 - e2))
+      x[i] = inv_norm_cdf(y[i]);
+  }
+}
@@ -1,3 +1,6 @@
 #pragma once
 
 double inv_norm_cdf(double y0);
+
+// x[i] = inv_norm_cdf(y[i]) for i = 0 .. n-1
+void inv_norm_cdf(int n, const double *y, double *x);
@@ -4,9 +4,17 @@
 #include <set>
 #include <vector>
 #include <iterator>
+#include <string>
+#include <algorithm>
 
 #include <SmurffCpp/Utils/Error.h>
 
+// LAPACK, provided by all supported BLAS libraries (OpenBLAS, MKL, LAPACK)
+extern "C" void dsyevr_(const char *jobz, const char *range, const char *uplo, const int *n, double *a, const int *lda,
+                        const double *vl, const double *vu, const int *il, const int *iu, const double *abstol,
+                        int *m, double *w, double *z, const int *ldz, int *isuppz,
+                        double *work, const int *lwork, int *iwork, const int *liwork, int *info);
+
 Eigen::MatrixXd smurff::matrix_utils::dense_to_eigen(const smurff::MatrixConfig& matrixConfig)
 {
    if(!matrixConfig.isDense())
@@ -174,3 +182,36 @@ bool smurff::matrix_utils::equals_vector(const Eigen::VectorXd& v1, const Eigen:
 
    return true;
 }
+
+void smurff::matrix_utils::symmetric_eigen(Eigen::MatrixXd& A, Eigen::MatrixXd& V, Eigen::VectorXd& lambda)
+{
+   THROWERROR_ASSERT_MSG(A.rows() == A.cols(), "symmetric_eigen: matrix must be square");
+
+   const int n = A.rows();
+   V.resize(n, n);
+   lambda.resize(n);
+   if (n == 0)
+      return;
+
+   const int lda = std::max(1, n);
+   const double vl = 0., vu = 0., abstol = 0.;
+   const int il = 0, iu = 0;
+   int m = 0, info = 0;
+   std::vector<int> isuppz(2 * n);
+
+   // workspace query
+   int lwork = -1, liwork = -1;
+   double work_size = 0.;
+   int iwork_size = 0;
+   dsyevr_("V", "A", "L", &n, A.data(), &lda, &vl, &vu, &il, &iu, &abstol, &m, lambda.data(), V.data(), &lda,
+           isuppz.data(), &work_size, &lwork, &iwork_size, &liwork, &info);
+   THROWERROR_ASSERT_MSG(info == 0, "dsyevr workspace query failed with info = " + std::to_string(info));
+
+   lwork = (int)work_size;
+   liwork = iwork_size;
+   std::vector<double> work(lwork);
+   std::vector<int> iwork(liwork);
+   dsyevr_("V", "A", "L", &n, A.data(), &lda, &vl, &vu, &il, &iu, &abstol, &m, lambda.data(), V.data(), &lda,
+           isuppz.data(), work.data(), &lwork, iwork.data(), &liwork, &info);
+   THROWERROR_ASSERT_MSG(info == 0 && m == n, "dsyevr failed with info = " + std::to_string(info));
+}
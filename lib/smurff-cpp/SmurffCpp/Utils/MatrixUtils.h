@@ -27,4 +27,10 @@ namespace smurff { namespace matrix_utils {
    bool equals(const Eigen::MatrixXd& m1, const Eigen::MatrixXd& m2, double precision = std::numeric_limits<double>::epsilon());
 
    bool equals_vector(const Eigen::VectorXd& v1, const Eigen::VectorXd& v2, double precision = std::numeric_limits<double>::epsilon() * 100);
+
+   // Eigendecomposition A = V diag(lambda) V' of a symmetric matrix, eigenvalues
+   // in ascending order. Only the lower triangle of A is used, A is overwritten.
+   // Uses LAPACK dsyevr, which is an order of magnitude faster than Eigen's
+   // SelfAdjointEigenSolver for large matrices.
+   void symmetric_eigen(Eigen::MatrixXd& A, Eigen::MatrixXd& V, Eigen::VectorXd& lambda);
 }}
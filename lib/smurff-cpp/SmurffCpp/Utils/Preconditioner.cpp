@@ -0,0 +1,98 @@
+#include "Preconditioner.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <SmurffCpp/SideInfo/ISideInfo.h>
+#include <SmurffCpp/Utils/Distribution.h>
+#include <SmurffCpp/Utils/omp_util.h>
+
+using namespace smurff;
+using namespace smurff::linop;
+
+JacobiPreconditioner::JacobiPreconditioner(ISideInfo& F, double reg)
+   : m_reg(reg)
+{
+   m_inv_diag = (F.col_square_sum().array() + reg).inverse();
+}
+
+void JacobiPreconditioner::apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const
+{
+   Z.noalias() = R * m_inv_diag.asDiagonal();
+}
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner(ISideInfo& F, double reg)
+   : m_reg(reg)
+{
+   const int nfeat = F.cols();
+   const int nblocks = (nfeat + BLOCK_SIZE - 1) / BLOCK_SIZE;
+   m_blocks.resize(nblocks);
+
+   threads::parallel_for(0, nblocks, [this, &F, reg, nfeat](std::int64_t b)
+   {
+      const int col = b * BLOCK_SIZE;
+      const int ncols = std::min(BLOCK_SIZE, nfeat - col);
+
+      Eigen::MatrixXd G;
+      F.At_mul_A_block(G, col, ncols);
+      G.diagonal().array() += reg;
+      m_blocks[b].compute(G);
+   });
+}
+
+void BlockJacobiPreconditioner::apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const
+{
+   const int nfeat = R.cols();
+   Z.resize(R.rows(), nfeat);
+
+   threads::parallel_for(0, m_blocks.size(), [this, &Z, &R, nfeat](std::int64_t b)
+   {
+      const int col = b * BLOCK_SIZE;
+      const int ncols = std::min(BLOCK_SIZE, nfeat - col);
+      Z.middleCols(col, ncols) = m_blocks[b].solve(R.middleCols(col, ncols).transpose()).transpose();
+   });
+}
+
+NystromPreconditioner::NystromPreconditioner(ISideInfo& F, double reg)
+   : m_reg(reg)
+{
+   const int nfeat = F.cols();
+   const int rank = std::min(RANK, nfeat);
+
+   // orthonormal random test matrix Q
+   Eigen::MatrixXd Omega(nfeat, rank);
+   bmrandn(Omega);
+   Eigen::MatrixXd Q = Eigen::HouseholderQR<Eigen::MatrixXd>(Omega).householderQ() * Eigen::MatrixXd::Identity(nfeat, rank);
+
+   // Y = F' * F * Q, computed as ((Q' * F') * F)'
+   Eigen::MatrixXd Qt = Q.transpose();
+   Eigen::MatrixXd QtFt;
+   F.compute_uhat(QtFt, Qt);
+   Eigen::MatrixXd Y = F.A_mul_B(QtFt).transpose();
+
+   // small shift, so that Q' * Y is positive definite
+   const double nu = std::numeric_limits<double>::epsilon() * Y.norm();
+   Y += nu * Q;
+
+   Eigen::MatrixXd QtY = Q.transpose() * Y;
+   QtY = (0.5 * (QtY + QtY.transpose())).eval();
+
+   // F' * F + nu * I ~ B * B', with B = Y * L^-T and Q' * Y = L * L'
+   Eigen::LLT<Eigen::MatrixXd> chol(QtY);
+   Eigen::MatrixXd Bt = chol.matrixL().solve(Y.transpose());
+
+   Eigen::JacobiSVD<Eigen::MatrixXd> svd(Bt.transpose(), Eigen::ComputeThinU);
+   m_U = svd.matrixU();
+
+   // singular values are sorted in decreasing order
+   Eigen::VectorXd lambda = (svd.singularValues().array().square() - nu).max(0.0);
+   const double lambda_min = lambda(rank - 1);
+   m_scale = (lambda_min + reg) / (lambda.array() + reg) - 1.0;
+}
+
+void NystromPreconditioner::apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const
+{
+   Eigen::MatrixXd RU = R * m_U;
+   Z = R;
+   Z.noalias() += (RU * m_scale.asDiagonal()) * m_U.transpose();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace smurff {
+
+class ISideInfo;
+
+namespace linop {
+
+// Preconditioners for solve_blockcg on the system (F' * F + reg * I) * X = B.
+//
+// Like the solver, they work on the transposed system: the nrhs x nfeat
+// residual R holds one right-hand side per row, and apply computes
+// Z = R * M^-1 for a symmetric positive definite M that approximates
+// F' * F + reg * I.
+class Preconditioner
+{
+public:
+   virtual ~Preconditioner() {}
+
+   // regularization the preconditioner was built for
+   virtual double reg() const = 0;
+
+   virtual void apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const = 0;
+};
+
+// M = diag(F' * F) + reg * I
+class JacobiPreconditioner : public Preconditioner
+{
+private:
+   double m_reg;
+   Eigen::VectorXd m_inv_diag;
+
+public:
+   JacobiPreconditioner(ISideInfo& F, double reg);
+
+   double reg() const override { return m_reg; }
+   void apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const override;
+};
+
+// M = block diagonal part of F' * F + reg * I,
+// with blocks of BLOCK_SIZE consecutive features
+class BlockJacobiPreconditioner : public Preconditioner
+{
+public:
+   static const int BLOCK_SIZE = 64;
+
+private:
+   double m_reg;
+   std::vector<Eigen::LLT<Eigen::MatrixXd>> m_blocks;
+
+public:
+   BlockJacobiPreconditioner(ISideInfo& F, double reg);
+
+   double reg() const override { return m_reg; }
+   void apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const override;
+};
+
+// Randomized Nystrom approximation F' * F ~ U * diag(lambda) * U' of rank RANK,
+// M^-1 = (lambda_min + reg) * U * (diag(lambda) + reg * I)^-1 * U' + (I - U * U')
+//
+// Captures the largest eigenvalues of F' * F, which is what slows down CG when
+// the column norms of F are very different. Draws its random test matrix from
+// the random generator.
+class NystromPreconditioner : public Preconditioner
+{
+public:
+   static const int RANK = 64;
+
+private:
+   double m_reg;
+   Eigen::MatrixXd m_U;       // nfeat x rank
+   Eigen::VectorXd m_scale;   // (lambda_min + reg) / (lambda + reg) - 1
+
+public:
+   NystromPreconditioner(ISideInfo& F, double reg);
+
+   double reg() const override { return m_reg; }
+   void apply(Eigen::MatrixXd& Z, const Eigen::MatrixXd& R) const override;
+};
+
+}}
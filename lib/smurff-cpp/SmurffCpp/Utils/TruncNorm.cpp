@@ -3,6 +3,7 @@
 #define _USE_MATH_DEFINES
 #endif
 
+#include <algorithm>
 #include <cmath>
 
 #include <SmurffCpp/Utils/InvNormCdf.h>
@@ -43,3 +44,31 @@ double rand_truncnorm(double mean, double std, double low_cut) {
 	return std * xbar + mean;
 }
 
+void rand_truncnorm(int n, const double *low_cut, double *x) {
+  const int B = 256;
+  double lower[B], u[B], rej[B];
+
+  for (int start = 0; start < n; start += B) {
+    const int m = std::min(B, n - start);
+    const double *a = low_cut + start;
+
+    for (int i = 0; i < m; i++)
+      lower[i] = norm_cdf(a[i]);
+
+    // the draws themselves are sequential
+    for (int i = 0; i < m; i++) {
+      if (a[i] > 3.0) {
+        rej[i] = rand_truncnorm_rej(a[i]);
+        u[i] = 0.5;
+      } else {
+        u[i] = smurff::rand_unif(lower[i], 1.0);
+      }
+    }
+
+    inv_norm_cdf(m, u, x + start);
+
+    for (int i = 0; i < m; i++)
+      if (a[i] > 3.0)
+        x[start + i] = rej[i];
+  }
+}
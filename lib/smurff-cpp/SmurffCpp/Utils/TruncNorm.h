@@ -3,3 +3,7 @@
 double norm_cdf(double x);
 double rand_truncnorm(double low_cut);
 double rand_truncnorm(double mean, double std, double low_cut);
+
+// x[i] = rand_truncnorm(low_cut[i]) for i = 0 .. n-1, the random numbers are
+// drawn in the same order, the inverse CDFs are evaluated in batches
+void rand_truncnorm(int n, const double *low_cut, double *x);
@@ -0,0 +1,109 @@
+#include "WorkPartition.h"
+
+#include <algorithm>
+
+#include <SmurffCpp/Utils/Error.h>
+
+using namespace smurff;
+
+WorkPartition::WorkPartition()
+   : m_chunk_start(1, 0), m_total_cost(0), m_heavy_cost(0)
+{
+}
+
+WorkPartition::WorkPartition(const std::vector<std::int64_t>& costs, int num_threads, bool split_heavy)
+   : m_total_cost(0), m_heavy_cost(0)
+{
+   THROWERROR_ASSERT(num_threads > 0);
+
+   const int num_items = costs.size();
+   const int max_chunks = std::max(1, std::min(num_items, num_threads * CHUNKS_PER_THREAD));
+
+   for (auto c : costs)
+      m_total_cost += c;
+
+   // Items above the share of one thread are heavy. While there are more
+   // light items than chunks, items larger than a chunk are heavy as well,
+   // taking them out makes the chunks smaller, so repeat. With at most one
+   // item per chunk the chunk size is the mean item cost and is not used,
+   // near-uniform items would all end up heavy.
+   m_is_heavy.resize(num_items, false);
+   const int num_chunks_full = num_threads * CHUNKS_PER_THREAD;
+   int num_light = num_items;
+   std::int64_t heavy_cost = std::max(HEAVY_MIN_COST, m_total_cost / num_threads);
+   bool changed = split_heavy;
+   while (changed)
+   {
+      changed = false;
+      for (int n = 0; n < num_items; ++n)
+      {
+         if (!m_is_heavy[n] && costs[n] > heavy_cost)
+         {
+            m_is_heavy[n] = true;
+            m_heavy_cost += costs[n];
+            num_light--;
+            changed = true;
+         }
+      }
+
+      if (num_light > num_chunks_full)
+      {
+         const std::int64_t chunk_cost = std::max(HEAVY_MIN_COST, (m_total_cost - m_heavy_cost) / num_chunks_full);
+         if (chunk_cost < heavy_cost)
+         {
+            heavy_cost = chunk_cost;
+            changed = true;
+         }
+      }
+   }
+
+   for (int n = 0; n < num_items; ++n)
+      if (m_is_heavy[n])
+         m_heavy_items.push_back(n);
+
+   // cut the light items where the running cost crosses a multiple of the target
+   const std::int64_t light_cost = m_total_cost - m_heavy_cost;
+   m_chunk_start.push_back(0);
+   std::int64_t running = 0;
+   std::int64_t chunk = 0;
+   for (int n = 0; n < num_items; ++n)
+   {
+      if (m_is_heavy[n])
+         continue;
+
+      running += costs[n];
+      chunk += costs[n];
+
+      const int c = m_chunk_cost.size();
+      if (c + 1 < max_chunks && running * max_chunks >= light_cost * (c + 1))
+      {
+         m_chunk_start.push_back(n + 1);
+         m_chunk_cost.push_back(chunk);
+         chunk = 0;
+      }
+   }
+
+   m_chunk_start.push_back(num_items);
+   m_chunk_cost.push_back(chunk);
+}
+
+double WorkPartition::imbalance() const
+{
+   const std::int64_t light_cost = m_total_cost - m_heavy_cost;
+   if (light_cost == 0)
+      return 1.0;
+
+   const std::int64_t max_cost = *std::max_element(m_chunk_cost.begin(), m_chunk_cost.end());
+   return (double)max_cost * num_chunks() / light_cost;
+}
+
+std::ostream& WorkPartition::info(std::ostream& os, std::string indent) const
+{
+   os << indent << num_items() << " items in " << num_chunks() << " chunks";
+   os << ", max/mean chunk cost: " << imbalance();
+   os << ", " << m_heavy_items.size() << " heavy items";
+   if (m_total_cost > 0)
+      os << " (" << 100. * m_heavy_cost / m_total_cost << "% of cost)";
+   os << std::endl;
+   return os;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace smurff {
+
+// Static partition of the items (columns of U) of one mode over threads,
+// based on a per-item cost (see Data::item_cost).
+//
+// Items that cost more than the share of one thread, or more than a balanced
+// chunk when there are more items than chunks, are "heavy": they are taken
+// out of the chunks and sampled one at a time, with their observations split
+// over all threads (see ScarceMatrixData::getMuLambda).
+// This only pays off if the data can split an item (Data::can_split_items),
+// otherwise no item is heavy.
+// The remaining items are cut into contiguous chunks of about equal cost,
+// CHUNKS_PER_THREAD per thread.
+class WorkPartition
+{
+public:
+   static const int CHUNKS_PER_THREAD = 4;
+
+   // items below this cost are never heavy, splitting them does not pay off
+   static const std::int64_t HEAVY_MIN_COST = 1000;
+
+private:
+   std::vector<int> m_chunk_start; // num_chunks + 1 boundaries
+   std::vector<std::int64_t> m_chunk_cost;
+   std::vector<int> m_heavy_items;
+   std::vector<bool> m_is_heavy;
+
+   std::int64_t m_total_cost;
+   std::int64_t m_heavy_cost;
+
+public:
+   WorkPartition();
+   WorkPartition(const std::vector<std::int64_t>& costs, int num_threads, bool split_heavy = true);
+
+   int num_items() const { return m_is_heavy.size(); }
+   int num_chunks() const { return m_chunk_cost.size(); }
+
+   // chunk c covers items [chunk_begin(c), chunk_end(c)), including heavy items
+   int chunk_begin(int c) const { return m_chunk_start.at(c); }
+   int chunk_end(int c) const { return m_chunk_start.at(c + 1); }
+
+   const std::vector<int>& heavy_items() const { return m_heavy_items; }
+   bool is_heavy(int n) const { return m_is_heavy[n]; }
+
+   // max cost of a chunk divided by the mean cost of a chunk
+   double imbalance() const;
+
+   std::ostream& info(std::ostream& os, std::string indent) const;
+};
+
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 #include <Eigen/IterativeLinearSolvers>
@@ -7,8 +10,13 @@
 #include <SmurffCpp/Utils/MatrixUtils.h>
 #include <SmurffCpp/Utils/Error.h>
 #include <SmurffCpp/Utils/counters.h>
+#include <SmurffCpp/Utils/omp_util.h>
+#include <SmurffCpp/Utils/Preconditioner.h>
 
 #include <SmurffCpp/SideInfo/SparseSideInfo.h>
+#include <SmurffCpp/SideInfo/BinarySideInfo.h>
+#include <SmurffCpp/SideInfo/ReducedDenseSideInfo.h>
+#include <SmurffCpp/SideInfo/CompositeSideInfo.h>
 
 namespace smurff {
 namespace linop {
@@ -87,11 +95,14 @@ namespace linop
 {
 
 template<typename T>
-int  solve_blockcg(Eigen::MatrixXd & X, T & t, double reg, Eigen::MatrixXd & B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false);
+int  solve_blockcg(Eigen::MatrixXd & X, T & t, double reg, Eigen::MatrixXd & B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error = false, bool warm_start = false, const Preconditioner *precond = nullptr);
 template<typename T>
-int  solve_blockcg(Eigen::MatrixXd & X, T & t, double reg, Eigen::MatrixXd & B, double tol, bool throw_on_cholesky_error = false);
+int  solve_blockcg(Eigen::MatrixXd & X, T & t, double reg, Eigen::MatrixXd & B, double tol, bool throw_on_cholesky_error = false, bool warm_start = false, const Preconditioner *precond = nullptr, bool deflate = true);
 
 inline void AtA_mul_B(Eigen::MatrixXd & out, SparseSideInfo & A, double reg, Eigen::MatrixXd & B);
+inline void AtA_mul_B(Eigen::MatrixXd & out, BinarySideInfo & A, double reg, Eigen::MatrixXd & B);
+inline void AtA_mul_B(Eigen::MatrixXd & out, ReducedDenseSideInfo & A, double reg, Eigen::MatrixXd & B);
+inline void AtA_mul_B(Eigen::MatrixXd & out, CompositeSideInfo & A, double reg, Eigen::MatrixXd & B);
 inline void AtA_mul_B(Eigen::MatrixXd & out, Eigen::MatrixXd & A, double reg, Eigen::MatrixXd & B);
 
 inline void makeSymmetric(Eigen::MatrixXd &A)
@@ -100,29 +111,39 @@ inline void makeSymmetric(Eigen::MatrixXd &A)
 }
 
 /** good values for solve_blockcg are blocksize=32 an excess=8 */
+//
+//   The blocks of right-hand sides are independent and solved concurrently,
+//   each on its share of the threads (threads::parallel_for_split)
+//
 template<typename T>
-inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd & B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error) {
+inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd & B, double tol, const int blocksize, const int excess, bool throw_on_cholesky_error, bool warm_start, const Preconditioner *precond) {
   if (B.rows() <= excess + blocksize) {
-    return solve_blockcg(X, K, reg, B, tol, throw_on_cholesky_error);
+    return solve_blockcg(X, K, reg, B, tol, throw_on_cholesky_error, warm_start, precond);
   }
   // split B into blocks of size <blocksize> (+ excess if needed)
-  Eigen::MatrixXd Xblock, Bblock;
-  int max_iter = 0;
+  std::vector<int> starts;
   for (int i = 0; i < B.rows(); i += blocksize) {
-    int nrows = blocksize;
+    starts.push_back(i);
     if (i + blocksize + excess >= B.rows()) {
-      nrows = B.rows() - i;
+      break;
     }
-    Bblock.resize(nrows, B.cols());
-    Xblock.resize(nrows, X.cols());
+  }
+  starts.push_back(B.rows());
 
-    Bblock = B.block(i, 0, nrows, B.cols());
-    int niter = solve_blockcg(Xblock, K, reg, Bblock, tol, throw_on_cholesky_error);
-    max_iter = std::max(niter, max_iter);
+  const int nblocks = starts.size() - 1;
+  std::vector<int> niter(nblocks, 0);
+  threads::parallel_for_split(0, nblocks, [&](std::int64_t b)
+  {
+    const int i = starts[b];
+    const int nrows = starts[b + 1] - i;
+    Eigen::MatrixXd Bblock = B.block(i, 0, nrows, B.cols());
+    Eigen::MatrixXd Xblock(nrows, X.cols());
+    if (warm_start) Xblock = X.block(i, 0, nrows, X.cols());
+    niter[b] = solve_blockcg(Xblock, K, reg, Bblock, tol, throw_on_cholesky_error, warm_start, precond);
     X.block(i, 0, nrows, X.cols()) = Xblock;
-  }
+  });
 
-  return max_iter;
+  return *std::max_element(niter.begin(), niter.end());
 }
 
 //
@@ -132,8 +153,16 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
 //   X = n x m matrix
 //   B = n x m matrix
 //
+//   With warm_start the iteration starts from the X passed in instead of from zero,
+//   the initial residual is then B - (K' * K + reg * I) * X
+//
+//   With a preconditioner M (see Preconditioner.h) the search directions are built
+//   from Z = R * M^-1 instead of R, and R R' is replaced by Z R'
+//
+//   With deflate, right-hand sides that have converged are dropped from the iteration
+//
 template<typename T>
-inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd & B, double tol, bool throw_on_cholesky_error) {
+inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd & B, double tol, bool throw_on_cholesky_error, bool warm_start, const Preconditioner *precond, bool deflate) {
   // initialize
   const int nfeat = B.cols();
   const int nrhs  = B.rows();
@@ -144,8 +173,7 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
   Eigen::VectorXd norms(nrhs), inorms(nrhs); 
   norms.setZero();
   inorms.setZero();
-  #pragma omp parallel for schedule(static)
-  for (int rhs = 0; rhs < nrhs; rhs++) 
+  threads::parallel_for(0, nrhs, [&](std::int64_t rhs)
   {
     double sumsq = 0.0;
     for (int feat = 0; feat < nfeat; feat++) 
@@ -154,24 +182,40 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
     }
     norms(rhs)  = std::sqrt(sumsq);
     inorms(rhs) = 1.0 / norms(rhs);
-  }
+  });
   Eigen::MatrixXd R(nrhs, nfeat);
   Eigen::MatrixXd P(nrhs, nfeat);
-  Eigen::MatrixXd Ptmp(nrhs, nfeat);
-  X.setZero();
-  // normalize R and P:
-  #pragma omp parallel for schedule(static) collapse(2)
-  for (int feat = 0; feat < nfeat; feat++) 
-  {
-    for (int rhs = 0; rhs < nrhs; rhs++) 
+  Eigen::MatrixXd Pnew(nrhs, nfeat);
+  if (warm_start) {
+    // R = B - (K' * K + reg * I) * X, normalize X, R and P:
+    AtA_mul_B(R, K, reg, X);
+    threads::parallel_for(0, nfeat, [&](std::int64_t feat)
     {
-      R(rhs, feat) = B(rhs, feat) * inorms(rhs);
-      P(rhs, feat) = R(rhs, feat);
-    }
+      for (int rhs = 0; rhs < nrhs; rhs++) 
+      {
+        R(rhs, feat) = (B(rhs, feat) - R(rhs, feat)) * inorms(rhs);
+        P(rhs, feat) = R(rhs, feat);
+        X(rhs, feat) *= inorms(rhs);
+      }
+    });
+  } else {
+    X.setZero();
+    // normalize R and P:
+    threads::parallel_for(0, nfeat, [&](std::int64_t feat)
+    {
+      for (int rhs = 0; rhs < nrhs; rhs++) 
+      {
+        R(rhs, feat) = B(rhs, feat) * inorms(rhs);
+        P(rhs, feat) = R(rhs, feat);
+      }
+    });
   }
   Eigen::MatrixXd* RtR = new Eigen::MatrixXd(nrhs, nrhs);
   Eigen::MatrixXd* RtR2 = new Eigen::MatrixXd(nrhs, nrhs);
 
+  // preconditioned residual
+  Eigen::MatrixXd Z;
+
   Eigen::MatrixXd KP(nrhs, nfeat);
   Eigen::MatrixXd PtKP(nrhs, nrhs);
   //Eigen::Matrix<double, N, N> A;
@@ -185,9 +229,29 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
 
   const int nblocks = (int)ceil(nfeat / 64.0);
 
+  // a warm start can already be close enough
+  const bool converged = warm_start && (RtR->diagonal().array() < tolsq).all();
+
+  if (precond) {
+    precond->apply(Z, R);
+    P = Z;
+    *RtR = Z * R.transpose();
+    makeSymmetric(*RtR);
+  }
+
+  Eigen::VectorXd d;
+
+  // right-hand sides that have converged are dropped from the iteration (deflation):
+  // Xa, R, P, KP and Z only hold the rows of the remaining ones, active maps them to rows of X
+  Eigen::MatrixXd Xa = X;
+  std::vector<int> active(nrhs);
+  for (int rhs = 0; rhs < nrhs; rhs++) active[rhs] = rhs;
+
   // CG iteration:
   int iter = 0;
-  for (iter = 0; iter < 1000; iter++) {
+  for (iter = 0; iter < 1000 && !converged; iter++) {
+    int nact = R.rows();
+
     // KP = K * P
     ////double t1 = tick();
     AtA_mul_B(KP, K, reg, P);
@@ -204,30 +268,38 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
     ////double t3 = tick();
 
     
-    #pragma omp parallel for schedule(guided)
-    for (int block = 0; block < nblocks; block++) 
+    threads::parallel_for(0, nblocks, [&](std::int64_t block)
     {
       int col = block * 64;
       int bcols = std::min(64, nfeat - col);
       // X += A' * P
-      X.block(0, col, nrhs, bcols).noalias() += A *  P.block(0, col, nrhs, bcols);
+      Xa.block(0, col, nact, bcols).noalias() += A *  P.block(0, col, nact, bcols);
       // R -= A' * KP
-      R.block(0, col, nrhs, bcols).noalias() -= A * KP.block(0, col, nrhs, bcols);
-    }
+      R.block(0, col, nact, bcols).noalias() -= A * KP.block(0, col, nact, bcols);
+    });
     ////double t4 = tick();
 
     // convergence check:
     //A_mul_At_combo(*RtR2, R);
-    *RtR2 = R * R.transpose();
-    makeSymmetric(*RtR2);
-
-    Eigen::VectorXd d = RtR2->diagonal();
+    if (precond) {
+      d = R.rowwise().squaredNorm();
+    } else {
+      *RtR2 = R * R.transpose();
+      makeSymmetric(*RtR2);
+      d = RtR2->diagonal();
+    }
     //std::cout << "[ iter " << iter << "] " << std::scientific << d.transpose() << " (max: " << d.maxCoeff() << " > " << tolsq << ")" << std::endl;
     //std::cout << iter << ":" << std::scientific << d.transpose() << std::endl;
     if ( (d.array() < tolsq).all()) {
       break;
     } 
 
+    if (precond) {
+      precond->apply(Z, R);
+      *RtR2 = Z * R.transpose();
+      makeSymmetric(*RtR2);
+    }
+
     // Psi = (R R') \ R2 R2'
     auto chol_RtR = RtR->llt();
     THROWERROR_ASSERT_MSG(!throw_on_cholesky_error || chol_RtR.info() != Eigen::NumericalIssue, "Cholesky Decomposition failed! (Numerical Issue)");
@@ -236,16 +308,39 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
     Psi.transposeInPlace();
     ////double t5 = tick();
 
-    // P = R + Psi' * P (P and R are already transposed)
-    #pragma omp parallel for schedule(guided)
-    for (int block = 0; block < nblocks; block++) 
+    // the new directions of the remaining right-hand sides are built from the old
+    // directions of all of them, only the rows of Psi and R2 are dropped before,
+    // the rows of P after the update
+    std::vector<int> keep;
+    for (int i = 0; i < nact; i++) {
+      if (!deflate || d(i) >= tolsq) keep.push_back(i);
+    }
+    const int nkeep = keep.size();
+    if (nkeep < nact) {
+      for (int i = 0; i < nact; i++) {
+        if (d(i) < tolsq) X.row(active[i]) = Xa.row(i);
+      }
+      for (int i = 0; i < nkeep; i++) active[i] = active[keep[i]];
+      active.resize(nkeep);
+
+      Psi = Psi(keep, Eigen::all).eval();
+      Xa  = Xa(keep, Eigen::all).eval();
+      R   = R(keep, Eigen::all).eval();
+      if (precond) Z = Z(keep, Eigen::all).eval();
+      *RtR2 = (*RtR2)(keep, keep).eval();
+    }
+
+    // P = R + Psi' * P (P and R are already transposed), Z instead of R with a preconditioner
+    const Eigen::MatrixXd &Rp = precond ? Z : R;
+    Pnew.resize(nkeep, nfeat);
+    threads::parallel_for(0, nblocks, [&](std::int64_t block)
     {
       int col = block * 64;
       int bcols = std::min(64, nfeat - col);
-      Eigen::MatrixXd xtmp(nrhs, bcols);
-      xtmp = Psi *  P.block(0, col, nrhs, bcols);
-      P.block(0, col, nrhs, bcols) = R.block(0, col, nrhs, bcols) + xtmp;
-    }
+      Pnew.block(0, col, nkeep, bcols).noalias() = Psi * P.block(0, col, nact, bcols);
+      Pnew.block(0, col, nkeep, bcols) += Rp.block(0, col, nkeep, bcols);
+    });
+    P.swap(Pnew);
 
     // R R' = R2 R2'
     std::swap(RtR, RtR2);
@@ -255,21 +350,23 @@ inline int solve_blockcg(Eigen::MatrixXd & X, T & K, double reg, Eigen::MatrixXd
   
   if (iter == 1000)
   {
-    Eigen::VectorXd d = RtR2->diagonal().cwiseSqrt();
     std::cerr << "warning: block_cg: could not find a solution in 1000 iterations; residual: ["
-              << d.transpose() << " ].all() > " << tol << std::endl;
+              << d.cwiseSqrt().transpose() << " ].all() > " << tol << std::endl;
   }
 
 
+  for (std::size_t i = 0; i < active.size(); i++) {
+    X.row(active[i]) = Xa.row(i);
+  }
+
   // unnormalizing X:
-  #pragma omp parallel for schedule(static) collapse(2)
-  for (int feat = 0; feat < nfeat; feat++) 
+  threads::parallel_for(0, nfeat, [&](std::int64_t feat)
   {
     for (int rhs = 0; rhs < nrhs; rhs++) 
     {
       X(rhs, feat) *= norms(rhs);
     }
-  }
+  });
   delete RtR;
   delete RtR2;
   return iter;
@@ -280,7 +377,19 @@ inline void AtA_mul_B(Eigen::MatrixXd & out, Eigen::MatrixXd & A, double reg, Ei
 }
 
 inline void AtA_mul_B(Eigen::MatrixXd& out, SparseSideInfo& A, double reg, Eigen::MatrixXd& B) {
-  out.noalias() = (A.Ft * (A.F * B.transpose())).transpose() + reg * B;
+  A.AtA_mul_B(out, reg, B);
+}
+
+inline void AtA_mul_B(Eigen::MatrixXd& out, BinarySideInfo& A, double reg, Eigen::MatrixXd& B) {
+  A.AtA_mul_B(out, reg, B);
+}
+
+inline void AtA_mul_B(Eigen::MatrixXd& out, ReducedDenseSideInfo& A, double reg, Eigen::MatrixXd& B) {
+  A.AtA_mul_B(out, reg, B);
+}
+
+inline void AtA_mul_B(Eigen::MatrixXd& out, CompositeSideInfo& A, double reg, Eigen::MatrixXd& B) {
+  A.AtA_mul_B(out, reg, B);
 }
 
 }}
\ No newline at end of file
@@ -1,25 +1,334 @@
 #include "omp_util.h"
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
 
+#if defined(USE_WORK_STEALING)
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#elif defined(_OPENMP)
+#include <omp.h>
+#include <vector>
+#endif
+
 #include <SmurffCpp/Utils/Error.h>
 
 namespace smurff
 {
 namespace threads
 {
+    // number of blocks per thread handed out by parallel_for_blocks
+    static const int BLOCKS_PER_THREAD = 8;
 
+    static void block_range(std::int64_t begin, std::int64_t end, int nblocks, int b, std::int64_t &from, std::int64_t &to)
+    {
+        // same split as schedule(static): the first (n % nblocks) blocks get one item more
+        const std::int64_t n = end - begin;
+        const std::int64_t q = n / nblocks;
+        const std::int64_t r = n % nblocks;
+        from = begin + b * q + std::min<std::int64_t>(b, r);
+        to = from + q + (b < r ? 1 : 0);
+    }
 
-    // _OPENMP will be enabled if -fopenmp flag is passed to the compiler (use cmake release build)
-    #if defined(_OPENMP)
+    static int num_blocks(std::int64_t n, int num_threads)
+    {
+        return (int)std::min<std::int64_t>(n, (std::int64_t)num_threads * BLOCKS_PER_THREAD);
+    }
+
+    #if defined(USE_WORK_STEALING)
+
+    // work stealing pool: thread 0 is the thread that calls into the pool,
+    // threads 1 .. n-1 are workers
+    namespace
+    {
+        struct group
+        {
+            std::atomic<long> pending;
+            std::mutex error_mutex;
+            std::exception_ptr error;
+
+            group() : pending(0) {}
+        };
+
+        struct task
+        {
+            std::function<void()> f;
+            group *g;
+        };
+
+        struct worker_queue
+        {
+            std::mutex m;
+            std::deque<task> q;
+        };
+
+        thread_local int t_thread_num = 0;
+        thread_local int t_depth = 0;
+
+        class pool
+        {
+        public:
+            pool(int num_threads)
+                : m_queues(num_threads), m_stop(false), m_queued(0)
+            {
+                for (auto &q : m_queues)
+                    q.reset(new worker_queue());
+
+                for (int t = 1; t < num_threads; ++t)
+                    m_workers.push_back(std::thread(&pool::worker_loop, this, t));
+            }
+
+            ~pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+                    m_stop = true;
+                }
+                m_wakeup.notify_all();
+                for (auto &w : m_workers)
+                    w.join();
+            }
 
-    #include <omp.h>
+            int size() const { return m_queues.size(); }
+
+            void push(const std::function<void()> &f, group &g)
+            {
+                g.pending++;
+                {
+                    auto &wq = *m_queues.at(t_thread_num);
+                    std::lock_guard<std::mutex> lock(wq.m);
+                    wq.q.push_back(task{f, &g});
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+                    m_queued++;
+                }
+                m_wakeup.notify_one();
+            }
+
+            // help with the tasks of g until all of them are done
+            // only tasks of g are run here: the caller may be in the middle of
+            // another task that holds thread local state (thread_vector::local)
+            void wait(group &g)
+            {
+                while (g.pending > 0)
+                {
+                    task t;
+                    if (take(t_thread_num, t, &g))
+                        run(t);
+                    else
+                        std::this_thread::yield();
+                }
+
+                if (g.error)
+                    std::rethrow_exception(g.error);
+            }
+
+        private:
+            // own queue from the back (most recent first), other queues from the front
+            // with only != nullptr only tasks of that group are taken
+            bool take(int tid, task &t, const group *only)
+            {
+                const int n = m_queues.size();
+                for (int k = 0; k < n; ++k)
+                {
+                    auto &wq = *m_queues[(tid + k) % n];
+                    std::lock_guard<std::mutex> lock(wq.m);
+                    if (k == 0)
+                    {
+                        for (auto it = wq.q.rbegin(); it != wq.q.rend(); ++it)
+                        {
+                            if (only && it->g != only)
+                                continue;
+                            t = *it;
+                            wq.q.erase(std::next(it).base());
+                            m_queued--;
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        for (auto it = wq.q.begin(); it != wq.q.end(); ++it)
+                        {
+                            if (only && it->g != only)
+                                continue;
+                            t = *it;
+                            wq.q.erase(it);
+                            m_queued--;
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            void run(task &t)
+            {
+                t_depth++;
+                try
+                {
+                    t.f();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(t.g->error_mutex);
+                    if (!t.g->error)
+                        t.g->error = std::current_exception();
+                }
+                t_depth--;
+                t.g->pending--;
+            }
+
+            void worker_loop(int tid)
+            {
+                t_thread_num = tid;
+                while (true)
+                {
+                    task t;
+                    if (take(tid, t, nullptr))
+                    {
+                        run(t);
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+                    m_wakeup.wait(lock, [this]() { return m_stop || m_queued > 0; });
+                    if (m_stop)
+                        return;
+                }
+            }
+
+            std::vector<std::unique_ptr<worker_queue> > m_queues;
+            std::vector<std::thread> m_workers;
+
+            std::mutex m_sleep_mutex;
+            std::condition_variable m_wakeup;
+            bool m_stop;
+            std::atomic<long> m_queued;
+        };
+
+        std::unique_ptr<pool> m_pool;
+
+        pool &get_pool()
+        {
+            if (!m_pool)
+                m_pool.reset(new pool(std::max(1u, std::thread::hardware_concurrency())));
+            return *m_pool;
+        }
+
+        void run_blocks(std::int64_t begin, std::int64_t end, int nblocks, const std::function<void(std::int64_t, std::int64_t)> &body)
+        {
+            if (nblocks <= 1)
+            {
+                if (begin < end)
+                    body(begin, end);
+                return;
+            }
+
+            auto &p = get_pool();
+            group g;
+            for (int b = 1; b < nblocks; ++b)
+            {
+                p.push([&body, begin, end, nblocks, b]() {
+                    std::int64_t from, to;
+                    block_range(begin, end, nblocks, b, from, to);
+                    body(from, to);
+                }, g);
+            }
+
+            std::int64_t from, to;
+            block_range(begin, end, nblocks, 0, from, to);
+            t_depth++;
+            try
+            {
+                body(from, to);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(g.error_mutex);
+                if (!g.error)
+                    g.error = std::current_exception();
+            }
+            t_depth--;
+
+            p.wait(g);
+        }
+    }
+
+    void init(int verbose, int num_threads)
+    {
+        const int n = (num_threads > 0) ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+        if (!m_pool || m_pool->size() != n)
+            m_pool.reset(new pool(n));
+
+        if (verbose)
+        {
+            std::cout << "Using work stealing pool with " << get_max_threads() << " threads.\n";
+        }
+    }
+
+    int get_num_threads() { return in_parallel() ? get_max_threads() : 1; }
+    int get_max_threads() { return get_pool().size(); }
+    int get_thread_num() { return t_thread_num; }
+    bool in_parallel() { return t_depth > 0; }
+
+    void parallel_for_blocks(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body)
+    {
+        run_blocks(begin, end, num_blocks(end - begin, get_max_threads()), body);
+    }
+
+    void parallel_for_static(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body)
+    {
+        run_blocks(begin, end, (int)std::min<std::int64_t>(end - begin, get_max_threads()), body);
+    }
+
+    void parallel_for_split(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t)> &body)
+    {
+        // nested loops already share the pool
+        run_blocks(begin, end, (int)std::max<std::int64_t>(end - begin, 0), [&body](std::int64_t from, std::int64_t to) {
+            for (std::int64_t i = from; i < to; ++i)
+                body(i);
+        });
+    }
+
+    struct task_group::state
+    {
+        group g;
+    };
+
+    void task_group::run(const std::function<void()> &f)
+    {
+        get_pool().push(f, m_state->g);
+    }
+
+    void task_group::wait()
+    {
+        get_pool().wait(m_state->g);
+    }
+
+    // _OPENMP will be enabled if -fopenmp flag is passed to the compiler (use cmake release build)
+    #elif defined(_OPENMP)
 
     static int  m_verbose = 0;
 
+    // > 1 in a thread running a parallel_for_split call with that many threads
+    // for its own parallel loops
+    static thread_local int t_split_threads = 0;
+
+    // loops inside a parallel region run serially, unless in parallel_for_split
+    static bool run_serial()
+    {
+        return in_parallel() && t_split_threads <= 1;
+    }
+
     int get_num_threads()
     {
-        return omp_get_num_threads(); 
+        return omp_get_num_threads();
     }
 
     int get_max_threads()
@@ -29,18 +338,22 @@ namespace threads
 
     int get_thread_num()
     {
-        return omp_get_thread_num(); 
+        return omp_get_thread_num();
     }
 
+    bool in_parallel()
+    {
+        return omp_in_parallel();
+    }
 
-    void init(int verbose, int num_threads) 
+    void init(int verbose, int num_threads)
     {
         m_verbose = verbose;
 
         if (num_threads > 0)
         {
             omp_set_num_threads(num_threads);
-        } 
+        }
 
         if (verbose)
         {
@@ -48,10 +361,140 @@ namespace threads
         }
     }
 
+    void parallel_for_blocks(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body)
+    {
+        if (run_serial())
+        {
+            if (begin < end)
+                body(begin, end);
+            return;
+        }
+
+        const int nblocks = num_blocks(end - begin, get_max_threads());
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < nblocks; ++b)
+        {
+            std::int64_t from, to;
+            block_range(begin, end, nblocks, b, from, to);
+            body(from, to);
+        }
+    }
+
+    void parallel_for_static(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body)
+    {
+        if (run_serial())
+        {
+            if (begin < end)
+                body(begin, end);
+            return;
+        }
+
+        #pragma omp parallel
+        {
+            std::int64_t from, to;
+            block_range(begin, end, get_num_threads(), get_thread_num(), from, to);
+            if (from < to)
+                body(from, to);
+        }
+    }
+
+    // body(i) for every i in [begin, end) on teams of their share of the threads,
+    // with in_order body(begin + t) runs on thread t of the outer team
+    static void run_split(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t)> &body, bool in_order)
+    {
+        const std::int64_t n = end - begin;
+        const int num_threads = get_max_threads();
+
+        if (run_serial() || n <= 1 || num_threads <= 1)
+        {
+            for (std::int64_t i = begin; i < end; ++i)
+                body(i);
+            return;
+        }
+
+        const int nouter = (int)std::min<std::int64_t>(n, num_threads);
+
+        // the loops inside body need a second active level
+        const int max_levels = omp_get_max_active_levels();
+        omp_set_max_active_levels(std::max(max_levels, 2));
+
+        std::exception_ptr error;
+        auto run = [&](std::int64_t i)
+        {
+            try
+            {
+                body(i);
+            }
+            catch (...)
+            {
+                #pragma omp critical
+                {
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        #pragma omp parallel num_threads(nouter)
+        {
+            // thread t gets its share of the threads, the first (num_threads % nouter) one more
+            const int t = omp_get_thread_num();
+            const int share = num_threads / nouter + (t < num_threads % nouter ? 1 : 0);
+            t_split_threads = share;
+            omp_set_num_threads(share);
+
+            if (in_order)
+            {
+                #pragma omp for schedule(static, 1)
+                for (std::int64_t i = begin; i < end; ++i)
+                    run(i);
+            }
+            else
+            {
+                #pragma omp for schedule(dynamic, 1)
+                for (std::int64_t i = begin; i < end; ++i)
+                    run(i);
+            }
+
+            t_split_threads = 0;
+        }
+
+        omp_set_max_active_levels(max_levels);
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void parallel_for_split(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t)> &body)
+    {
+        run_split(begin, end, body, false);
+    }
+
+    // tasks are collected and run by wait(), task t on thread t of the outer team
+    // like the calling thread would, so the first task keeps the random generator
+    // of the calling thread
+    struct task_group::state
+    {
+        std::vector<std::function<void()> > tasks;
+    };
+
+    void task_group::run(const std::function<void()> &f)
+    {
+        m_state->tasks.push_back(f);
+    }
+
+    void task_group::wait()
+    {
+        std::vector<std::function<void()> > tasks;
+        tasks.swap(m_state->tasks);
+        run_split(0, tasks.size(), [&tasks](std::int64_t i) { tasks[i](); }, true);
+    }
+
     #else
 
-    void init(int verbose, int) 
-    { 
+    void init(int verbose, int)
+    {
         if (verbose)
         {
             std::cout << "No threading library used.\n";
@@ -61,9 +504,81 @@ namespace threads
 
     int  get_num_threads() { return 1; }
     int  get_max_threads() { return 1; }
-    int  get_thread_num() { return 0; } 
+    int  get_thread_num() { return 0; }
+    bool in_parallel() { return false; }
+
+    void parallel_for_blocks(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body)
+    {
+        if (begin < end)
+            body(begin, end);
+    }
+
+    void parallel_for_static(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body)
+    {
+        if (begin < end)
+            body(begin, end);
+    }
+
+    void parallel_for_split(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t)> &body)
+    {
+        for (std::int64_t i = begin; i < end; ++i)
+            body(i);
+    }
+
+    #endif
+
+    #if !defined(USE_WORK_STEALING) && !defined(_OPENMP)
+
+    // tasks run in the calling thread, in the order they are added
+    struct task_group::state
+    {
+        std::exception_ptr error;
+    };
+
+    void task_group::run(const std::function<void()> &f)
+    {
+        if (m_state->error)
+            return;
 
-    #endif // _OPENMP
+        try
+        {
+            f();
+        }
+        catch (...)
+        {
+            m_state->error = std::current_exception();
+        }
+    }
+
+    void task_group::wait()
+    {
+        if (m_state->error)
+            std::rethrow_exception(m_state->error);
+    }
+
+    #endif
+
+    task_group::task_group()
+        : m_state(new state())
+    {
+    }
+
+    task_group::~task_group()
+    {
+    #if defined(USE_WORK_STEALING)
+        // tasks still refer to the group, do not leave before they are done
+        if (m_state->g.pending > 0)
+        {
+            try { wait(); } catch (...) {}
+        }
+    #elif defined(_OPENMP)
+        // tasks that were never waited for still run
+        if (!m_state->tasks.empty())
+        {
+            try { wait(); } catch (...) {}
+        }
+    #endif
+    }
 }
 
 }
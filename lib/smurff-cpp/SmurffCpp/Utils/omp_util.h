@@ -1,16 +1,76 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+
 namespace smurff
 {
-    namespace threads 
+    namespace threads
     {
         void init(int verbose, int num_threads);
 
         int  get_num_threads();
         int  get_max_threads();
         int  get_thread_num();
+        bool in_parallel();
 
-    }
-}
+        // All parallel loops and tasks of the sampler go through these functions.
+        //
+        // The backend is chosen at build time:
+        //  - OpenMP (default): parallel_for is an omp parallel for, the tasks of a
+        //    task_group run concurrently in wait(), each on its share of the
+        //    threads like parallel_for_split. Loops in the tasks get the thread
+        //    numbers of their own team, so only one task may use per-thread state
+        //    such as the random generators in its loops
+        //  - work stealing pool (USE_WORK_STEALING, cmake -DENABLE_WORK_STEALING=ON):
+        //    one worker per thread, each with its own deque; idle workers steal
+        //    from the others. Loops nested in tasks are parallel too, without a
+        //    fork/join barrier, and tasks in a task_group run concurrently
+        //  - serial, when built without OpenMP
+        //
+        // With OpenMP, a loop started inside a parallel region runs serially
+        // in the calling thread.
+
+        // calls body(from, to) for consecutive blocks of [begin, end)
+        void parallel_for_blocks(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body);
+
+        // calls body(from, to) with one contiguous block of [begin, end) per thread,
+        // block t goes to thread t with the OpenMP backend, like schedule(static)
+        void parallel_for_static(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t, std::int64_t)> &body);
 
+        // calls body(i) for every i in [begin, end), the calls run concurrently and
+        // the threads are split evenly over them: parallel loops inside body(i)
+        // run on the share of the threads of body(i)
+        // meant for a few large independent pieces of work that are parallel
+        // loops themselves, like the right-hand side blocks of solve_blockcg
+        void parallel_for_split(std::int64_t begin, std::int64_t end, const std::function<void(std::int64_t)> &body);
 
+        // calls f(i) for every i in [begin, end)
+        template<typename F>
+        void parallel_for(std::int64_t begin, std::int64_t end, F f)
+        {
+            parallel_for_blocks(begin, end, [&f](std::int64_t from, std::int64_t to) {
+                for (std::int64_t i = from; i < to; ++i)
+                    f(i);
+            });
+        }
+
+        // group of tasks that may run concurrently, wait() returns when all are done
+        // exceptions thrown by a task are rethrown by wait()
+        // with OpenMP the tasks only start in wait() (or when the group is destroyed)
+        class task_group
+        {
+        public:
+            task_group();
+            ~task_group();
+
+            void run(const std::function<void()> &f);
+            void wait();
+
+        private:
+            struct state;
+            std::unique_ptr<state> m_state;
+        };
+    }
+}
@@ -18,6 +18,7 @@
 
 #include <SmurffCpp/Utils/Error.h>
 #include <SmurffCpp/Utils/StepFile.h>
+#include <SmurffCpp/Utils/ThreadVector.hpp>
 #include <SmurffCpp/Utils/StringUtils.h>
 
 #include <SmurffCpp/IO/GenericIO.h>
@@ -263,18 +264,17 @@ void Result::update(std::shared_ptr<const Model> model, bool burnin)
 
    if (burnin)
    {
-      double se_1sample = 0.0;
+      thread_vector<double> se_1sample(0.0);
 
-      #pragma omp parallel for schedule(guided) reduction(+:se_1sample)
-      for(size_t k = 0; k < m_predictions.size(); ++k)
+      threads::parallel_for(0, m_predictions.size(), [this, &model, &se_1sample](std::int64_t k)
       {
          auto &t = m_predictions.operator[](k);
          t.pred_1sample = model->predict(t.coords); //dot product of i'th columns in each U matrix
-         se_1sample += std::pow(t.val - t.pred_1sample, 2);
-      }
+         se_1sample.local() += std::pow(t.val - t.pred_1sample, 2);
+      });
 
       burnin_iter++;
-      rmse_1sample = std::sqrt(se_1sample / NNZ);
+      rmse_1sample = std::sqrt(se_1sample.combine() / NNZ);
 
       if (classify)
       {
@@ -284,23 +284,22 @@ void Result::update(std::shared_ptr<const Model> model, bool burnin)
    }
    else
    {
-      double se_1sample = 0.0;
-      double se_avg = 0.0;
+      thread_vector<double> se_1sample(0.0);
+      thread_vector<double> se_avg(0.0);
 
-      #pragma omp parallel for schedule(guided) reduction(+:se_1sample, se_avg)
-      for(size_t k = 0; k < m_predictions.size(); ++k)
+      threads::parallel_for(0, m_predictions.size(), [this, &model, &se_1sample, &se_avg](std::int64_t k)
       {
          auto &t = m_predictions.operator[](k);
          const double pred = model->predict(t.coords); //dot product of i'th columns in each U matrix
          t.update(pred);
 
-         se_1sample += std::pow(t.val - pred, 2);
-         se_avg += std::pow(t.val - t.pred_avg, 2);
-      }
+         se_1sample.local() += std::pow(t.val - pred, 2);
+         se_avg.local() += std::pow(t.val - t.pred_avg, 2);
+      });
 
       sample_iter++;
-      rmse_1sample = std::sqrt(se_1sample / NNZ);
-      rmse_avg = std::sqrt(se_avg / NNZ);
+      rmse_1sample = std::sqrt(se_1sample.combine() / NNZ);
+      rmse_avg = std::sqrt(se_avg.combine() / NNZ);
 
       if (classify)
       {
@@ -3,6 +3,7 @@
 #include <SmurffCpp/Utils/Error.h>
 #include <SmurffCpp/Utils/linop.h>
 #include <SmurffCpp/Utils/Distribution.h>
+#include <SmurffCpp/SideInfo/DenseSideInfo.h>
 
 using namespace smurff;
 
@@ -50,6 +51,360 @@ TEST_CASE( "SparseSideInfo/solve_blockcg_1_0", "BlockCG solver (3rhs separately)
    }
 }
 
+TEST_CASE( "SparseSideInfo/AtA_mul_B", "F' * F * B' + reg * B' for several numbers of right-hand sides" ) 
+{
+   const int nrows = 50, ncols = 20;
+   std::vector<uint32_t> rows, cols;
+   std::vector<double> vals;
+   for (int i = 0; i < nrows; i++)
+      for (int j = 0; j < ncols; j++)
+         if ((i * 7 + j * 3) % 5 == 0) {
+            rows.push_back(i);
+            cols.push_back(j);
+            vals.push_back(0.1 * ((i + 2 * j) % 11) - 0.5);
+         }
+   SparseSideInfo sf(std::make_shared<MatrixConfig>(nrows, ncols, rows, cols, vals, fixed_ncfg, false));
+   Eigen::MatrixXd F = Eigen::MatrixXd(sf.F);
+
+   const double reg = 0.5;
+   for (int nrhs : { 1, 3, 4, 13 }) {
+      Eigen::MatrixXd B(nrhs, ncols);
+      for (int i = 0; i < nrhs; i++)
+         for (int j = 0; j < ncols; j++)
+            B(i, j) = ((i * 5 + j * 3) % 7) - 3.0;
+
+      Eigen::MatrixXd out;
+      smurff::linop::AtA_mul_B(out, sf, reg, B);
+      Eigen::MatrixXd expected = (F.transpose() * F * B.transpose() + reg * B.transpose()).transpose();
+      REQUIRE( (out - expected).norm() < 1e-10 );
+   }
+}
+
+TEST_CASE( "SparseSideInfo/At_mul_A", "Sparse SYRK against the dense F' * F, more columns than the mirror tile" ) 
+{
+   const int nrows = 40, ncols = 150;
+   std::vector<uint32_t> rows, cols;
+   std::vector<double> vals;
+   for (int i = 0; i < nrows; i++)
+      for (int j = 0; j < ncols; j++)
+         // column 17 and row 5 stay empty
+         if ((i * 7 + j * 3) % 11 < 3 && j != 17 && i != 5) {
+            rows.push_back(i);
+            cols.push_back(j);
+            vals.push_back(0.1 * ((i + 2 * j) % 13) - 0.6);
+         }
+   SparseSideInfo sf(std::make_shared<MatrixConfig>(nrows, ncols, rows, cols, vals, fixed_ncfg, false));
+   Eigen::MatrixXd F = Eigen::MatrixXd(sf.F);
+
+   Eigen::MatrixXd out = Eigen::MatrixXd::Constant(3, 3, 7.0);
+   sf.At_mul_A(out);
+   REQUIRE( out.rows() == ncols );
+   REQUIRE( out.cols() == ncols );
+   REQUIRE( (out - F.transpose() * F).norm() < 1e-10 );
+
+   // a range of columns that includes the empty column 17
+   sf.At_mul_A_block(out, 12, 9);
+   REQUIRE( (out - F.middleCols(12, 9).transpose() * F.middleCols(12, 9)).norm() < 1e-10 );
+}
+
+TEST_CASE( "BinarySideInfo/linop", "BinarySideInfo gives the same results as SparseSideInfo with all values 1" ) 
+{
+   const int nrows = 30, ncols = 12;
+   std::vector<uint32_t> rows, cols;
+   // not sorted by row or column
+   for (int j = ncols - 1; j >= 0; j--)
+      for (int i = 0; i < nrows; i++)
+         if ((i * 5 + j * 7) % 4 == 0) {
+            rows.push_back(i);
+            cols.push_back(j);
+         }
+   auto mc = std::make_shared<MatrixConfig>(nrows, ncols, rows, cols, fixed_ncfg, false);
+   BinarySideInfo bf(mc);
+   SparseSideInfo sf(mc);
+
+   REQUIRE( bf.rows() == nrows );
+   REQUIRE( bf.cols() == ncols );
+   REQUIRE( bf.nnz() == rows.size() );
+
+   Eigen::MatrixXd beta(3, ncols), U(3, nrows);
+   for (int j = 0; j < ncols; j++) beta.col(j) << j, 1.0 - j, 0.5 * j * j;
+   for (int i = 0; i < nrows; i++) U.col(i) << i % 7, 2.0 - i, 0.1 * i;
+
+   Eigen::MatrixXd out_b, out_s;
+   bf.compute_uhat(out_b, beta);
+   sf.compute_uhat(out_s, beta);
+   REQUIRE( (out_b - out_s).norm() < 1e-10 );
+
+   REQUIRE( (bf.A_mul_B(U) - sf.A_mul_B(U)).norm() < 1e-10 );
+
+   bf.At_mul_A(out_b);
+   sf.At_mul_A(out_s);
+   REQUIRE( (out_b - out_s).norm() < 1e-10 );
+
+   bf.At_mul_A_block(out_b, 3, 5);
+   sf.At_mul_A_block(out_s, 3, 5);
+   REQUIRE( (out_b - out_s).norm() < 1e-10 );
+
+   smurff::linop::AtA_mul_B(out_b, bf, 0.5, beta);
+   smurff::linop::AtA_mul_B(out_s, sf, 0.5, beta);
+   REQUIRE( (out_b - out_s).norm() < 1e-10 );
+
+   REQUIRE( (bf.col_square_sum() - sf.col_square_sum()).norm() < 1e-10 );
+
+   Eigen::VectorXd y_b, y_s, b(3);
+   bf.At_mul_Bt(y_b, 4, U);
+   sf.At_mul_Bt(y_s, 4, U);
+   REQUIRE( (y_b - y_s).norm() < 1e-10 );
+
+   b << 1.0, -2.0, 0.5;
+   Eigen::MatrixXd Z_b = U, Z_s = U;
+   bf.add_Acol_mul_bt(Z_b, 4, b);
+   sf.add_Acol_mul_bt(Z_s, 4, b);
+   REQUIRE( (Z_b - Z_s).norm() < 1e-10 );
+
+   Eigen::MatrixXd X_b(3, ncols), X_s(3, ncols);
+   bf.solve_blockcg(X_b, 0.5, beta, 1e-8, 32, 8, true);
+   sf.solve_blockcg(X_s, 0.5, beta, 1e-8, 32, 8, true);
+   REQUIRE( (X_b - X_s).norm() < 1e-6 );
+}
+
+TEST_CASE( "ISideInfo/column_sweep", "Column sweeps of the side info types against the generic At_mul_Bt / add_Acol_mul_bt sweep" ) 
+{
+   const int nrows = 30, ncols = 12;
+   std::vector<uint32_t> rows, cols;
+   std::vector<double> vals, dense(nrows * ncols, 0.0);
+   for (int j = 0; j < ncols; j++)
+      for (int i = 0; i < nrows; i++)
+         if ((i * 5 + j * 7) % 4 == 0) {
+            rows.push_back(i);
+            cols.push_back(j);
+            vals.push_back(1.0 + 0.1 * i - 0.2 * j);
+            dense[i + j * nrows] = vals.back();
+         }
+   auto mc = std::make_shared<MatrixConfig>(nrows, ncols, rows, cols, vals, fixed_ncfg, false);
+   auto bc = std::make_shared<MatrixConfig>(nrows, ncols, rows, cols, fixed_ncfg, false);
+   auto dc = std::make_shared<MatrixConfig>(nrows, ncols, dense, fixed_ncfg);
+   SparseSideInfo sf(mc);
+   BinarySideInfo bf(bc);
+   DenseSideInfo df(dc);
+
+   // the update depends on zx, so every column sees the changes of the previous ones
+   auto sweep = [](ISideInfo &side, Eigen::MatrixXd &Z, bool generic) {
+      Eigen::MatrixXd zxs(Z.rows(), side.cols());
+      auto update = [&](int col, const Eigen::VectorXd& zx, Eigen::VectorXd& b) {
+         zxs.col(col) = zx;
+         b = -0.05 * zx;
+         b(0) += col;
+      };
+      if (generic) side.ISideInfo::column_sweep(Z, update);
+      else side.column_sweep(Z, update);
+      return zxs;
+   };
+
+   for (int dcount : {1, 3, 4, 5})
+   {
+      Eigen::MatrixXd Z0(dcount, nrows);
+      for (int d = 0; d < dcount; d++)
+         for (int i = 0; i < nrows; i++)
+            Z0(d, i) = std::sin(1.0 + d + 0.3 * i);
+
+      for (ISideInfo *side : std::vector<ISideInfo *>{&sf, &bf, &df})
+      {
+         Eigen::MatrixXd Z = Z0, Z_generic = Z0;
+         Eigen::MatrixXd zxs = sweep(*side, Z, false);
+         Eigen::MatrixXd zxs_generic = sweep(*side, Z_generic, true);
+         REQUIRE( (zxs - zxs_generic).norm() < 1e-10 );
+         REQUIRE( (Z - Z_generic).norm() < 1e-10 );
+      }
+   }
+}
+
+TEST_CASE( "ReducedDenseSideInfo/linop", "float32 and uint8 side info against the double side info with the same values" ) 
+{
+   const int nrows = 300, ncols = 270;
+   std::vector<double> values(nrows * ncols);
+   for (int j = 0; j < ncols; j++)
+      for (int i = 0; i < nrows; i++)
+         values[i + j * nrows] = std::sin(0.1 * i + 0.37 * j) * (1 + j % 5);
+   auto mc = std::make_shared<MatrixConfig>(nrows, ncols, values, fixed_ncfg);
+
+   for (DenseStorageTypes storage : { DenseStorageTypes::float32, DenseStorageTypes::uint8 }) {
+      ReducedDenseSideInfo rf(mc, storage);
+      Eigen::MatrixXd F = rf.decoded();
+
+      // rounding of the stored values
+      Eigen::Map<const Eigen::MatrixXd> F_orig(values.data(), nrows, ncols);
+      const double max_err = (storage == DenseStorageTypes::float32) ? 1e-6 : 5 * 2.0 / 255 / 2;
+      REQUIRE( (F - F_orig).cwiseAbs().maxCoeff() <= max_err );
+
+      // the products are done in double on the stored values
+      DenseSideInfo df(matrix_utils::eigen_to_dense(F, fixed_ncfg));
+
+      Eigen::MatrixXd beta(3, ncols), U(3, nrows);
+      for (int j = 0; j < ncols; j++) beta.col(j) << std::cos(j), 0.01 * j, 1.0;
+      for (int i = 0; i < nrows; i++) U.col(i) << i % 7, 2.0 - 0.01 * i, 0.1;
+
+      Eigen::MatrixXd out_r, out_d;
+      rf.compute_uhat(out_r, beta);
+      df.compute_uhat(out_d, beta);
+      REQUIRE( (out_r - out_d).norm() < 1e-10 * out_d.norm() );
+
+      REQUIRE( (rf.A_mul_B(U) - df.A_mul_B(U)).norm() < 1e-10 * df.A_mul_B(U).norm() );
+
+      rf.At_mul_A(out_r);
+      df.At_mul_A(out_d);
+      REQUIRE( (out_r - out_d).norm() < 1e-10 * out_d.norm() );
+
+      rf.At_mul_A_block(out_r, 10, 64);
+      df.At_mul_A_block(out_d, 10, 64);
+      REQUIRE( (out_r - out_d).norm() < 1e-10 * out_d.norm() );
+
+      // more than one tile of PANEL_SIZE columns
+      rf.At_mul_A_block(out_r, 5, 260);
+      df.At_mul_A_block(out_d, 5, 260);
+      REQUIRE( (out_r - out_d).norm() < 1e-10 * out_d.norm() );
+
+      REQUIRE( (rf.col_square_sum() - df.col_square_sum()).norm() < 1e-10 * df.col_square_sum().norm() );
+
+      smurff::linop::AtA_mul_B(out_r, rf, 0.5, beta);
+      Eigen::MatrixXd expected = (F.transpose() * F * beta.transpose() + 0.5 * beta.transpose()).transpose();
+      REQUIRE( (out_r - expected).norm() < 1e-10 * expected.norm() );
+
+      Eigen::VectorXd y_r, y_d, b(3);
+      rf.At_mul_Bt(y_r, 4, U);
+      df.At_mul_Bt(y_d, 4, U);
+      REQUIRE( (y_r - y_d).norm() < 1e-10 * y_d.norm() );
+
+      b << 1.0, -2.0, 0.5;
+      Eigen::MatrixXd Z_r = U, Z_d = U;
+      rf.add_Acol_mul_bt(Z_r, 4, b);
+      df.add_Acol_mul_bt(Z_d, 4, b);
+      REQUIRE( (Z_r - Z_d).norm() < 1e-10 * Z_d.norm() );
+   }
+}
+
+TEST_CASE( "ReducedDenseSideInfo/uint8_integral", "integer columns spanning at most 255 are stored exactly in uint8" ) 
+{
+   const int nrows = 200, ncols = 4;
+   std::vector<double> values(nrows * ncols);
+   for (int i = 0; i < nrows; i++)
+   {
+      values[i + 0 * nrows] = i % 2;                   // binary
+      values[i + 1 * nrows] = (i * 37) % 256;          // full 0 .. 255 range
+      values[i + 2 * nrows] = -100.0 + (i * 13) % 200; // negative offset
+      values[i + 3 * nrows] = 7.0;                     // constant
+   }
+   auto mc = std::make_shared<MatrixConfig>(nrows, ncols, values, fixed_ncfg);
+
+   ReducedDenseSideInfo rf(mc, DenseStorageTypes::uint8);
+   Eigen::Map<const Eigen::MatrixXd> F_orig(values.data(), nrows, ncols);
+   REQUIRE( (rf.decoded() - F_orig).cwiseAbs().maxCoeff() == 0.0 );
+}
+
+TEST_CASE( "CompositeSideInfo/linop", "Sparse, dense, binary and uint8 blocks against the dense side info of their concatenation" ) 
+{
+   const int nrows = 60;
+   const int ncols[] = { 40, 25, 30, 20 };
+   std::vector<std::shared_ptr<ISideInfo> > blocks;
+   std::vector<Eigen::MatrixXd> dense_blocks;
+   for (int k = 0; k < 4; k++)
+   {
+      std::vector<uint32_t> rows, cols;
+      std::vector<double> vals, dense(nrows * ncols[k], 0.0);
+      for (int j = 0; j < ncols[k]; j++)
+         for (int i = 0; i < nrows; i++)
+            if (k == 1 || k == 3 || (i * 5 + j * 7 + k) % 6 == 0) {
+               rows.push_back(i);
+               cols.push_back(j);
+               vals.push_back(k == 2 ? 1.0 : std::sin(0.3 * i + 0.7 * j + k));
+               dense[i + j * nrows] = vals.back();
+            }
+
+      if (k == 0)
+         blocks.push_back(std::make_shared<SparseSideInfo>(std::make_shared<MatrixConfig>(nrows, ncols[k], rows, cols, vals, fixed_ncfg, false)));
+      else if (k == 1)
+         blocks.push_back(std::make_shared<DenseSideInfo>(std::make_shared<MatrixConfig>(nrows, ncols[k], dense, fixed_ncfg)));
+      else if (k == 2)
+         blocks.push_back(std::make_shared<BinarySideInfo>(std::make_shared<MatrixConfig>(nrows, ncols[k], rows, cols, fixed_ncfg, false)));
+      else
+         blocks.push_back(std::make_shared<ReducedDenseSideInfo>(std::make_shared<MatrixConfig>(nrows, ncols[k], dense, fixed_ncfg), DenseStorageTypes::uint8));
+
+      if (k == 3)
+         dense_blocks.push_back(std::dynamic_pointer_cast<ReducedDenseSideInfo>(blocks.back())->decoded());
+      else
+         dense_blocks.push_back(Eigen::Map<Eigen::MatrixXd>(dense.data(), nrows, ncols[k]));
+   }
+
+   CompositeSideInfo cf(blocks);
+   Eigen::MatrixXd F(nrows, cf.cols());
+   for (int k = 0; k < 4; k++)
+      F.middleCols(cf.offset(k), ncols[k]) = dense_blocks[k];
+   DenseSideInfo df(matrix_utils::eigen_to_dense(F, fixed_ncfg));
+
+   REQUIRE( cf.cols() == 115 );
+   REQUIRE( cf.rows() == nrows );
+
+   Eigen::MatrixXd beta(3, cf.cols()), U(3, nrows);
+   for (int j = 0; j < cf.cols(); j++) beta.col(j) << std::cos(j), 0.01 * j, 1.0;
+   for (int i = 0; i < nrows; i++) U.col(i) << i % 7, 2.0 - 0.01 * i, 0.1;
+
+   Eigen::MatrixXd out_c, out_d;
+   cf.compute_uhat(out_c, beta);
+   df.compute_uhat(out_d, beta);
+   REQUIRE( (out_c - out_d).norm() < 1e-10 * out_d.norm() );
+
+   REQUIRE( (cf.A_mul_B(U) - df.A_mul_B(U)).norm() < 1e-10 * df.A_mul_B(U).norm() );
+
+   cf.At_mul_A(out_c);
+   df.At_mul_A(out_d);
+   REQUIRE( (out_c - out_d).norm() < 1e-10 * out_d.norm() );
+
+   // inside one block and across three blocks
+   for (int col : { 3, 35 }) {
+      cf.At_mul_A_block(out_c, col, 64);
+      df.At_mul_A_block(out_d, col, 64);
+      REQUIRE( (out_c - out_d).norm() < 1e-10 * out_d.norm() );
+   }
+
+   REQUIRE( (cf.col_square_sum() - df.col_square_sum()).norm() < 1e-10 * df.col_square_sum().norm() );
+
+   smurff::linop::AtA_mul_B(out_c, cf, 0.5, beta);
+   Eigen::MatrixXd expected = (F.transpose() * F * beta.transpose() + 0.5 * beta.transpose()).transpose();
+   REQUIRE( (out_c - expected).norm() < 1e-10 * expected.norm() );
+
+   Eigen::MatrixXd X_c(3, cf.cols()), X_d(3, cf.cols());
+   cf.solve_blockcg(X_c, 0.5, beta, 1e-8, 3, 0);
+   df.solve_blockcg(X_d, 0.5, beta, 1e-8, 3, 0);
+   REQUIRE( (X_c - X_d).norm() < 1e-6 * X_d.norm() );
+
+   Eigen::VectorXd y_c, y_d, b(3);
+   b << 1.0, -2.0, 0.5;
+   for (int col : { 0, 39, 40, 100, 114 }) {
+      cf.At_mul_Bt(y_c, col, U);
+      df.At_mul_Bt(y_d, col, U);
+      REQUIRE( (y_c - y_d).norm() < 1e-10 * (1 + y_d.norm()) );
+
+      Eigen::MatrixXd Z_c = U, Z_d = U;
+      cf.add_Acol_mul_bt(Z_c, col, b);
+      df.add_Acol_mul_bt(Z_d, col, b);
+      REQUIRE( (Z_c - Z_d).norm() < 1e-10 * Z_d.norm() );
+   }
+
+   Eigen::MatrixXd Z_c = U, Z_d = U;
+   Eigen::MatrixXd zxs_c(3, cf.cols()), zxs_d(3, cf.cols());
+   auto update = [](Eigen::MatrixXd &zxs) {
+      return [&zxs](int col, const Eigen::VectorXd& zx, Eigen::VectorXd& b) {
+         zxs.col(col) = zx;
+         b = -0.05 * zx;
+         b(0) += 0.01 * col;
+      };
+   };
+   cf.column_sweep(Z_c, update(zxs_c));
+   df.column_sweep(Z_d, update(zxs_d));
+   REQUIRE( (zxs_c - zxs_d).norm() < 1e-10 * zxs_d.norm() );
+   REQUIRE( (Z_c - Z_d).norm() < 1e-10 * Z_d.norm() );
+}
+
 TEST_CASE( "linop/solve_blockcg_dense/fail", "BlockCG solver for dense (3rhs separately) [!hide]" ) 
 {
    int rows[9] = { 0, 3, 3, 2, 5, 4, 1, 2, 4 };
@@ -103,6 +458,151 @@ TEST_CASE( "linop/solve_blockcg_dense/ok", "BlockCG solver for dense (3rhs separ
    }
 }
 
+TEST_CASE( "linop/solve_blockcg_dense/warm_start", "BlockCG solver started from a previous solution" ) 
+{
+   double reg = 0.5;
+
+   Eigen::MatrixXd K(8, 6);
+   K.setZero();
+   for (int i = 0; i < 8; i++)
+      for (int j = 0; j < 6; j++)
+         if ((i + 2 * j) % 3 == 0) K(i, j) = 1.0 + 0.1 * i - 0.2 * j;
+
+   Eigen::MatrixXd X_true(3, 6);
+   X_true << 0.35555556,  0.40709677, -0.16444444, -0.87483871, -0.16444444, -0.87483871,
+             1.69333333, -0.12709677, -1.94666667,  0.49483871, -1.94666667,  0.49483871,
+             0.66      , -0.04064516, -0.78      ,  0.65225806, -0.78      ,  0.65225806;
+
+   Eigen::MatrixXd B = ((K.transpose() * K + Eigen::MatrixXd::Identity(6,6) * reg) * X_true.transpose()).transpose();
+
+   Eigen::MatrixXd X_cold(3, 6);
+   int iter_cold = smurff::linop::solve_blockcg(X_cold, K, reg, B, 1e-6, true);
+
+   // start close to the solution
+   Eigen::MatrixXd X = X_true;
+   for (int i = 0; i < X.rows(); i++)
+      for (int j = 0; j < X.cols(); j++)
+         X(i, j) += 1e-4 * ((i * 5 + j * 3) % 7 - 3);
+   int iter_warm = smurff::linop::solve_blockcg(X, K, reg, B, 1e-6, true, true);
+
+   REQUIRE( (X - X_true).norm() < 1e-5 );
+   REQUIRE( (X_cold - X_true).norm() < 1e-5 );
+   REQUIRE( iter_warm <= iter_cold );
+
+   // the exact solution needs no iterations
+   X = X_true;
+   REQUIRE( smurff::linop::solve_blockcg(X, K, reg, B, 1e-6, true, true) == 0 );
+   REQUIRE( (X - X_true).norm() < 1e-10 );
+}
+
+TEST_CASE( "linop/solve_blockcg_dense/blocks", "BlockCG solver with the right-hand sides split in blocks" ) 
+{
+   const double reg = 0.5;
+   const int nrhs = 100, nfeat = 1000;
+
+   std::uint32_t state = 4321;
+   auto next = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) / double(1 << 24) - 0.5; };
+
+   Eigen::MatrixXd K(1200, nfeat), B(nrhs, nfeat);
+   for (int i = 0; i < K.rows(); i++)
+      for (int j = 0; j < K.cols(); j++)
+         K(i, j) = next();
+   for (int i = 0; i < B.rows(); i++)
+      for (int j = 0; j < B.cols(); j++)
+         B(i, j) = next() * (1 + i % 7);
+
+   Eigen::MatrixXd KtK = K.transpose() * K + Eigen::MatrixXd::Identity(nfeat, nfeat) * reg;
+   Eigen::MatrixXd X_true = KtK.llt().solve(B.transpose()).transpose();
+
+   // blocks of 32, 32 and 36 rows, each stops iterating on the rows that have converged
+   Eigen::MatrixXd X(nrhs, nfeat);
+   int niter = smurff::linop::solve_blockcg(X, K, reg, B, 1e-8, 32, 8, true);
+   REQUIRE( niter < 1000 );
+   for (int i = 0; i < nrhs; i++) {
+      REQUIRE( (X.row(i) - X_true.row(i)).norm() / X_true.row(i).norm() < 1e-6 );
+   }
+}
+
+TEST_CASE( "linop/solve_blockcg_dense/deflation", "Dropping converged right-hand sides does not slow down the others" ) 
+{
+   const double reg = 0.5;
+   const int nrhs = 6, nfeat = 200;
+
+   std::uint32_t state = 777;
+   auto next = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) / double(1 << 24) - 0.5; };
+
+   Eigen::MatrixXd K(300, nfeat), B(nrhs, nfeat);
+   for (int i = 0; i < K.rows(); i++)
+      for (int j = 0; j < K.cols(); j++)
+         K(i, j) = next() * (1 + j / 20.0);
+   for (int j = 0; j < nfeat; j++)
+      B.col(j) << next(), next(), next(), next(), 0.0, 0.0;
+
+   Eigen::MatrixXd KtK = K.transpose() * K + Eigen::MatrixXd::Identity(nfeat, nfeat) * reg;
+
+   // the last two right-hand sides span an invariant subspace of K'K and converge
+   // in the first iteration, the others need many more
+   Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(KtK);
+   B.row(4) = (eig.eigenvectors().col(10) + eig.eigenvectors().col(150)).transpose();
+   B.row(5) = (eig.eigenvectors().col(10) - 2.0 * eig.eigenvectors().col(150)).transpose();
+   Eigen::MatrixXd X_true = KtK.llt().solve(B.transpose()).transpose();
+
+   Eigen::MatrixXd X(nrhs, nfeat), X_full(nrhs, nfeat);
+   int iter = smurff::linop::solve_blockcg(X, K, reg, B, 1e-8, true, false, nullptr, true);
+   int iter_full = smurff::linop::solve_blockcg(X_full, K, reg, B, 1e-8, true, false, nullptr, false);
+
+   REQUIRE( iter < 1000 );
+   REQUIRE( iter <= iter_full );
+   for (int i = 0; i < nrhs; i++) {
+      REQUIRE( (X.row(i) - X_true.row(i)).norm() / X_true.row(i).norm() < 1e-6 );
+      REQUIRE( (X.row(i) - X_full.row(i)).norm() / X_full.row(i).norm() < 1e-6 );
+   }
+}
+
+TEST_CASE( "linop/solve_blockcg/preconditioner", "Preconditioned BlockCG solver on side info with very different column norms" ) 
+{
+   const int nrows = 600, ncols = 150;
+   std::vector<uint32_t> rows, cols;
+   std::vector<double> vals;
+   std::uint32_t state = 12345;
+   auto next = [&state]() { state = state * 1664525u + 1013904223u; return (state >> 8) / double(1 << 24); };
+   for (int i = 0; i < nrows; i++)
+      for (int j = 0; j < ncols; j++)
+         if (next() < 0.2) {
+            rows.push_back(i);
+            cols.push_back(j);
+            vals.push_back(std::pow(10.0, j / 40.0) * (0.5 + next()));
+         }
+   SparseSideInfo sf(std::make_shared<MatrixConfig>(nrows, ncols, rows, cols, vals, fixed_ncfg, false));
+
+   const double reg = 0.5;
+   Eigen::MatrixXd B(3, ncols);
+   for (int i = 0; i < B.rows(); i++)
+      for (int j = 0; j < B.cols(); j++)
+         B(i, j) = ((i * 11 + j * 5) % 9) - 4.0;
+
+   Eigen::MatrixXd FtF;
+   sf.At_mul_A(FtF);
+   FtF.diagonal().array() += reg;
+
+   init_bmrng(1234);
+   linop::JacobiPreconditioner jacobi(sf, reg);
+   linop::BlockJacobiPreconditioner blockjacobi(sf, reg);
+   linop::NystromPreconditioner nystrom(sf, reg);
+
+   // without preconditioner this needs more than 1000 iterations
+   for (const linop::Preconditioner *precond : std::vector<const linop::Preconditioner *>{&jacobi, &blockjacobi, &nystrom}) {
+      Eigen::MatrixXd X(3, ncols);
+      int iter = smurff::linop::solve_blockcg(X, sf, reg, B, 1e-8, true, false, precond);
+      REQUIRE( iter < 1000 );
+      REQUIRE( (FtF * X.transpose() - B.transpose()).norm() / B.norm() < 1e-6 );
+   }
+
+   Eigen::MatrixXd X(3, ncols);
+   REQUIRE( smurff::linop::solve_blockcg(X, sf, reg, B, 1e-8, true, false, &jacobi) < 100 );
+   REQUIRE( smurff::linop::solve_blockcg(X, sf, reg, B, 1e-8, true, false, &blockjacobi) < 100 );
+}
+
 TEST_CASE( "Eigen::MatrixFree::1", "Test smurff::linop::AtA_mulB - 1" )
 {
   std::vector<uint32_t> rows = {0, 3, 3, 2, 5, 4, 1, 2, 4};
@@ -1,5 +1,7 @@
 #include "catch.hpp"
 
+#include <cmath>
+
 #include <Eigen/Core>
 
 #include <SmurffCpp/Configs/TensorConfig.h>
@@ -241,3 +243,25 @@ TEST_CASE("matrix_utils::slice : 5D tensor")
       REQUIRE(matrix_utils::equals(actualTensorSlice, expectedTensorSlice));
    }
 }
+
+TEST_CASE("matrix_utils::symmetric_eigen")
+{
+   Eigen::MatrixXd F(7, 5);
+   for (int i = 0; i < F.rows(); i++)
+      for (int j = 0; j < F.cols(); j++)
+         F(i, j) = std::sin(1.0 + 3 * i + j);
+
+   Eigen::MatrixXd FtF = F.transpose() * F;
+   Eigen::MatrixXd A = FtF;
+   Eigen::MatrixXd V;
+   Eigen::VectorXd lambda;
+   matrix_utils::symmetric_eigen(A, V, lambda);
+
+   REQUIRE(V.rows() == 5);
+   REQUIRE(lambda.size() == 5);
+   for (int i = 1; i < lambda.size(); i++)
+      REQUIRE(lambda(i - 1) <= lambda(i));
+
+   REQUIRE((V * lambda.asDiagonal() * V.transpose() - FtF).norm() < 1e-10);
+   REQUIRE((V.transpose() * V - Eigen::MatrixXd::Identity(5, 5)).norm() < 1e-10);
+}
@@ -2888,6 +2888,125 @@ TEST_CASE(
    REQUIRE_RESULT_ITEMS(tensorRunResults, matrixRunResults);
 }
 
+//
+//      train: 1. sparse matrix
+//             2. sparse matrix
+//       test: 1. sparse matrix
+//             2. sparse matrix
+//     priors: normal normal
+// latent-sampler: 1. single
+//                 2. batched
+// num-latent: 4
+//     burnin: 50
+//   nsamples: 50
+//    verbose: 0
+//       seed: 1234
+//
+// Gaussian noise draws nothing in add_mu_lambda, so both samplers use the
+// mt19937 numbers in the same order
+//
+TEST_CASE(
+   "single vs batched latent sampler"
+   "--train <train_sparse_matrix> --test <test_sparse_matrix> --prior normal normal --latent-sampler single  --num-latent 4 --burnin 50 --nsamples 50 --verbose 0 --seed 1234"
+   "--train <train_sparse_matrix> --test <test_sparse_matrix> --prior normal normal --latent-sampler batched --num-latent 4 --burnin 50 --nsamples 50 --verbose 0 --seed 1234"
+   , TAG_VS_TESTS)
+{
+   Config singleRunConfig;
+   singleRunConfig.setTrain(getTrainSparseMatrixConfig());
+   singleRunConfig.setTest(getTestSparseMatrixConfig());
+   singleRunConfig.setPriorTypes({PriorTypes::normal, PriorTypes::normal});
+   singleRunConfig.setNumLatent(4);
+   singleRunConfig.setBurnin(50);
+   singleRunConfig.setNSamples(50);
+   singleRunConfig.setVerbose(false);
+   singleRunConfig.setRandomSeed(1234);
+
+   Config batchedRunConfig = singleRunConfig;
+   batchedRunConfig.setLatentSamplerType(LatentSamplerTypes::batched);
+
+   std::shared_ptr<ISession> singleRunSession = SessionFactory::create_session(singleRunConfig);
+   singleRunSession->run();
+
+   std::shared_ptr<ISession> batchedRunSession = SessionFactory::create_session(batchedRunConfig);
+   batchedRunSession->run();
+
+   REQUIRE(singleRunSession->getRmseAvg() == Approx(batchedRunSession->getRmseAvg()).epsilon(APPROX_EPSILON));
+   REQUIRE_RESULT_ITEMS(singleRunSession->getResultItems(), batchedRunSession->getResultItems());
+}
+
+//
+//      train: sparse matrix with one fully observed column, probit noise
+//       test: sparse matrix
+//     priors: normal normal
+// random-generator: philox
+// num-threads: 1. 1
+//              2. 8
+// num-latent: 4
+//     burnin: 20
+//   nsamples: 20
+//    verbose: 0
+//       seed: 1234
+//
+TEST_CASE(
+   "philox: 1 vs 8 threads with probit noise and a heavy column"
+   "--train <train_sparse_matrix> --test <test_sparse_matrix> --prior normal normal --random-generator philox --num-threads 1 --num-latent 4 --burnin 20 --nsamples 20 --verbose 0 --seed 1234"
+   "--train <train_sparse_matrix> --test <test_sparse_matrix> --prior normal normal --random-generator philox --num-threads 8 --num-latent 4 --burnin 20 --nsamples 20 --verbose 0 --seed 1234"
+   , TAG_VS_TESTS)
+{
+   // column 0 is observed in every row, between 1/8 and 1/4 of all observations,
+   // so it is split over the threads with 8 threads (see WorkPartition) and
+   // sampled as a whole with 1 thread
+   const int nrows = 2000, ncols = 40;
+   std::vector<std::uint32_t> trainRows, trainCols, testRows, testCols;
+   std::vector<double> trainVals, testVals;
+   for (int i = 0; i < nrows; i++)
+      for (int j = 0; j < ncols; j++)
+      {
+         const double val = ((i * 7 + j * 3) % 5 < 2) ? 1.0 : 0.0;
+         if (j == 0 || (i * 13 + j * 29) % 11 == 0)
+         {
+            trainRows.push_back(i);
+            trainCols.push_back(j);
+            trainVals.push_back(val);
+         }
+         else if ((i * 13 + j * 29) % 97 == 0)
+         {
+            testRows.push_back(i);
+            testCols.push_back(j);
+            testVals.push_back(val);
+         }
+      }
+
+   NoiseConfig probit_ncfg(NoiseTypes::probit);
+   probit_ncfg.setThreshold(0.5);
+
+   Config oneThreadConfig;
+   oneThreadConfig.setTrain(std::make_shared<MatrixConfig>(nrows, ncols, std::move(trainRows), std::move(trainCols), std::move(trainVals), probit_ncfg, true));
+   oneThreadConfig.setTest(std::make_shared<MatrixConfig>(nrows, ncols, std::move(testRows), std::move(testCols), std::move(testVals), fixed_ncfg, true));
+   oneThreadConfig.setPriorTypes({PriorTypes::normal, PriorTypes::normal});
+   oneThreadConfig.setRandomGeneratorType(RandomGeneratorTypes::philox);
+   oneThreadConfig.setNumLatent(4);
+   oneThreadConfig.setBurnin(20);
+   oneThreadConfig.setNSamples(20);
+   oneThreadConfig.setVerbose(false);
+   oneThreadConfig.setRandomSeed(1234);
+   oneThreadConfig.setThreshold(0.5);
+   oneThreadConfig.setNumThreads(1);
+
+   Config eightThreadsConfig = oneThreadConfig;
+   eightThreadsConfig.setNumThreads(8);
+
+   std::shared_ptr<ISession> oneThreadSession = SessionFactory::create_session(oneThreadConfig);
+   oneThreadSession->run();
+
+   std::shared_ptr<ISession> eightThreadsSession = SessionFactory::create_session(eightThreadsConfig);
+   eightThreadsSession->run();
+
+   // the draws are the same, only the sums over the threads are rounded differently
+   REQUIRE(oneThreadSession->getRmseAvg() == Approx(eightThreadsSession->getRmseAvg()).epsilon(APPROX_EPSILON));
+   REQUIRE_RESULT_ITEMS(oneThreadSession->getResultItems(), eightThreadsSession->getResultItems());
+}
+
 TEST_CASE("PredictSession/BPMF")
 {
    std::shared_ptr<MatrixConfig> trainDenseMatrixConfig = getTrainDenseMatrixConfig();
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <vector>
 #include <limits>
+#include <algorithm>
 
 #include <SmurffCpp/Model.h>
 #include <SmurffCpp/result.h>
@@ -17,6 +18,9 @@
 #include <SmurffCpp/Utils/counters.h>
 #include <SmurffCpp/Utils/MatrixUtils.h>
 #include <SmurffCpp/Utils/linop.h>
+#include <SmurffCpp/Utils/BatchCholesky.h>
+#include <SmurffCpp/Utils/WorkPartition.h>
+#include <SmurffCpp/Utils/ThreadVector.hpp>
 
 #include <SmurffCpp/Configs/MatrixConfig.h>
 
@@ -33,6 +37,7 @@
 #include <SmurffCpp/DataMatrices/DenseMatrixData.h>
 
 #include <SmurffCpp/SideInfo/DenseSideInfo.h>
+#include <SmurffCpp/SideInfo/SparseSideInfo.h>
 
 // https://github.com/catchorg/Catch2/blob/master/docs/assertions.md#floating-point-comparisons
 // By default Catch.hpp sets epsilon to std::numeric_limits<float>::epsilon()*100
@@ -175,6 +180,197 @@ TEST_CASE( "DenseMatrixData/var_total", "Test if variance of Dense Matrix is cor
   REQUIRE(data->var_total() == Approx(1.25));
 }
 
+TEST_CASE( "SparseMatrixData/sumsq", "Closed form sumsq gives the same result as summing over all cells") {
+  std::vector<std::uint32_t> rows = {0, 1, 1, 3, 4, 4};
+  std::vector<std::uint32_t> cols = {0, 0, 2, 1, 2, 3};
+  std::vector<double>        vals = {1., -2., 3., 4., -5., 6.};
+
+  const MatrixConfig S(5, 4, rows, cols, vals, fixed_ncfg, false);
+  std::shared_ptr<Data> data(new SparseMatrixData(matrix_utils::sparse_to_eigen(S)));
+  data->setNoiseModel(NoiseFactory::create_noise_model(fixed_ncfg));
+  data->init();
+
+  init_bmrng(1234);
+  Model model;
+  model.init(3, data->dim(), ModelInitTypes::random, false);
+
+  Eigen::MatrixXd Y = Eigen::MatrixXd::Zero(5, 4);
+  for (std::size_t i = 0; i < vals.size(); i++) Y(rows[i], cols[i]) = vals[i];
+  const double expected = (model.U(0).transpose() * model.U(1) - Y).squaredNorm();
+
+  REQUIRE( data->sumsq(model.full()) == Approx(expected) );
+}
+
+TEST_CASE( "ScarceMatrixData/residual_cache", "sumsq from the residual cache matches recomputing the predictions") {
+  std::vector<std::uint32_t> rows = {0, 1, 1, 2, 2, 2, 3};
+  std::vector<std::uint32_t> cols = {0, 0, 1, 0, 1, 2, 2};
+  std::vector<double>        vals = {1., 2., 3., 4., 5., 6., 7.};
+
+  const MatrixConfig S(4, 3, rows, cols, vals, fixed_ncfg, false);
+  std::shared_ptr<Data> cached(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S), true));
+  std::shared_ptr<Data> plain(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S)));
+  for (auto data : {cached, plain}) {
+    data->setNoiseModel(NoiseFactory::create_noise_model(fixed_ncfg));
+    data->init();
+  }
+
+  init_bmrng(1234);
+  Model model;
+  model.init(4, cached->dim(), ModelInitTypes::random, false);
+  const SubModel submodel = model.full();
+
+  // sampling the last mode fills the cache
+  cached->update_pnm(submodel, 1);
+  for (int d = 0; d < cached->dim(1); d++)
+    cached->update_residuals(submodel, 1, d);
+
+  REQUIRE( cached->sumsq(submodel) == Approx(plain->sumsq(submodel)) );
+
+  // sampling another mode invalidates it
+  model.U(0).setZero();
+  cached->update_pnm(submodel, 0);
+  REQUIRE( cached->sumsq(submodel) == Approx(plain->sumsq(submodel)) );
+}
+
+TEST_CASE( "ScarceMatrixData/getMuLambda", "Fixed size and dynamic size kernels give the same result") {
+  std::vector<std::uint32_t> rows = {0, 1, 1, 2, 2, 2};
+  std::vector<std::uint32_t> cols = {0, 0, 1, 0, 1, 2};
+  std::vector<double>        vals = {1., 2., 3., 4., 5., 6.};
+
+  const MatrixConfig S(3, 3, rows, cols, vals, fixed_ncfg, false);
+  std::shared_ptr<Data> data(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S)));
+  data->setNoiseModel(NoiseFactory::create_noise_model(fixed_ncfg));
+  data->init();
+
+  const double alpha = data->noise().getAlpha();
+
+  for (int K : {8, 9}) {
+    init_bmrng(1234);
+    Model model;
+    model.init(K, data->dim(), ModelInitTypes::random, false);
+    SubModel submodel = model.full();
+
+    // row 2 of Y, against columns of V
+    const Eigen::MatrixXd &V = model.U(1);
+    Eigen::VectorXd rr = Eigen::VectorXd::Zero(K);
+    Eigen::MatrixXd MM = Eigen::MatrixXd::Zero(K, K);
+    data->getMuLambda(submodel, 0, 2, rr, MM);
+
+    Eigen::VectorXd expected_rr = alpha * (4. * V.col(0) + 5. * V.col(1) + 6. * V.col(2));
+    Eigen::MatrixXd expected_MM = alpha * V * V.transpose();
+
+    REQUIRE( (rr - expected_rr).norm() < 1e-10 );
+    REQUIRE( (MM - expected_MM).norm() < 1e-10 );
+    REQUIRE( model.predict({2, 1}) == Approx(model.U(0).col(2).dot(V.col(1))) );
+  }
+}
+
+TEST_CASE( "ScarceMatrixData/getMuLambda/gather", "Columns with many nonzeros give the same result through the gather path") {
+  const int N = 300; // more than one gather tile
+  std::vector<std::uint32_t> rows, cols;
+  std::vector<double> vals;
+  for (int i = 0; i < N; i++)
+    for (int j = 0; j < N; j++) {
+      rows.push_back(i);
+      cols.push_back(j);
+      vals.push_back((i * 7 + j * 3) % 11 - 5.);
+    }
+
+  const MatrixConfig S(N, N, rows, cols, vals, fixed_ncfg, false);
+  std::shared_ptr<Data> data(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S)));
+  data->setNoiseModel(NoiseFactory::create_noise_model(fixed_ncfg));
+  data->init();
+
+  const double alpha = data->noise().getAlpha();
+  const int K = 8;
+
+  init_bmrng(1234);
+  Model model;
+  model.init(K, data->dim(), ModelInitTypes::random, false);
+  SubModel submodel = model.full();
+
+  const Eigen::MatrixXd &V = model.U(1);
+  Eigen::VectorXd rr = Eigen::VectorXd::Zero(K);
+  Eigen::MatrixXd MM = Eigen::MatrixXd::Zero(K, K);
+  data->getMuLambda(submodel, 0, 4, rr, MM);
+
+  Eigen::VectorXd y(N);
+  for (int j = 0; j < N; j++) y(j) = alpha * ((4 * 7 + j * 3) % 11 - 5.);
+
+  REQUIRE( (rr - V * y).norm() < 1e-8 );
+  REQUIRE( (MM - alpha * V * V.transpose()).norm() < 1e-8 );
+}
+
+TEST_CASE( "ScarceMatrixData/getMuLambdaSplit", "Splitting the nonzeros of an item over threads gives the same result, also for few nonzeros") {
+  const int N = 300;
+  std::vector<std::uint32_t> rows, cols;
+  std::vector<double> vals;
+  for (int i = 0; i < N; i++)
+    for (int j = 0; j < N; j++)
+      if (j < 10 || i % 3 == 0) {
+        rows.push_back(j);
+        cols.push_back(i);
+        vals.push_back((i * 7 + j * 3) % 11 - 5.);
+      }
+
+  const MatrixConfig S(N, N, rows, cols, vals, fixed_ncfg, false);
+  std::shared_ptr<Data> data(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S)));
+  data->setNoiseModel(NoiseFactory::create_noise_model(fixed_ncfg));
+  data->init();
+  REQUIRE( data->can_split_items() );
+
+  const int K = 8;
+  init_bmrng(1234);
+  Model model;
+  model.init(K, data->dim(), ModelInitTypes::random, false);
+  SubModel submodel = model.full();
+
+  // column 0 has N nonzeros, column 1 only 10, less than one gather tile
+  for (int d : {0, 1}) {
+    Eigen::VectorXd rr = Eigen::VectorXd::Zero(K), rr_split = Eigen::VectorXd::Zero(K);
+    Eigen::MatrixXd MM = Eigen::MatrixXd::Zero(K, K), MM_split = Eigen::MatrixXd::Zero(K, K);
+    data->getMuLambda(submodel, 1, d, rr, MM);
+    data->getMuLambdaSplit(submodel, 1, d, rr_split, MM_split);
+
+    REQUIRE( rr.norm() > 0 );
+    REQUIRE( (rr - rr_split).norm() < 1e-8 );
+    REQUIRE( (MM - MM_split).norm() < 1e-8 );
+  }
+}
+
+TEST_CASE( "ScarceMatrixData/getMuLambdaLowRank", "Low rank form gives the same precision as getMuLambda") {
+  std::vector<std::uint32_t> rows = {0, 1, 1, 2, 2, 2};
+  std::vector<std::uint32_t> cols = {0, 0, 1, 0, 1, 2};
+  std::vector<double>        vals = {1., 2., 3., 4., 5., 6.};
+
+  const MatrixConfig S(3, 3, rows, cols, vals, fixed_ncfg, false);
+  std::shared_ptr<Data> data(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S)));
+  data->setNoiseModel(NoiseFactory::create_noise_model(fixed_ncfg));
+  data->init();
+
+  const int K = 8;
+  init_bmrng(1234);
+  Model model;
+  model.init(K, data->dim(), ModelInitTypes::random, false);
+  SubModel submodel = model.full();
+
+  for (int d = 0; d < 3; d++) {
+    REQUIRE( data->pnm_rank(0, d) == d + 1 );
+
+    Eigen::VectorXd rr = Eigen::VectorXd::Zero(K);
+    Eigen::MatrixXd MM = Eigen::MatrixXd::Zero(K, K);
+    data->getMuLambda(submodel, 0, d, rr, MM);
+
+    Eigen::VectorXd rr_lowrank = Eigen::VectorXd::Zero(K);
+    Eigen::MatrixXd W;
+    data->getMuLambdaLowRank(submodel, 0, d, rr_lowrank, W);
+
+    REQUIRE( W.cols() == d + 1 );
+    REQUIRE( (rr - rr_lowrank).norm() < 1e-10 );
+    REQUIRE( (MM - W * W.transpose()).norm() < 1e-10 );
+  }
+}
+
 using namespace Eigen;
 using namespace std;
 
@@ -184,11 +380,87 @@ MacauPrior* make_dense_prior(int nlatent, const std::vector<double> & ptr, int n
    std::shared_ptr<MatrixConfig> Fmat_ptr = std::make_shared<MatrixConfig>(nrows, ncols, ptr, fixed_ncfg);
    std::shared_ptr<DenseSideInfo> side_info = std::make_shared<DenseSideInfo>(Fmat_ptr);
    ret->addSideInfo(side_info, 10.0, 1e-6, comp_FtF, true, false);
-   ret->FtF_plus_precision.resize(ncols, ncols);
-   ret->Features->At_mul_A(ret->FtF_plus_precision);
+   ret->compute_FtF_eigen();
    return ret;
 }
 
+TEST_CASE( "ScarceMatrixData/getMuLambda/probit", "Probit noise kernel gives the same result as ProbitNoise::sample") {
+  std::vector<std::uint32_t> rows = {0, 1, 1, 2, 2, 2};
+  std::vector<std::uint32_t> cols = {0, 0, 1, 0, 1, 2};
+  std::vector<double>        vals = {1., 2., 3., 4., 5., 6.};
+
+  NoiseConfig probit_ncfg(NoiseTypes::probit);
+  probit_ncfg.setThreshold(4.5);
+
+  const MatrixConfig S(3, 3, rows, cols, vals, probit_ncfg, false);
+  std::shared_ptr<Data> data(new ScarceMatrixData(matrix_utils::sparse_to_eigen(S)));
+  data->setNoiseModel(NoiseFactory::create_noise_model(probit_ncfg));
+  data->init();
+
+  for (int K : {8, 9}) {
+    init_bmrng(1234);
+    Model model;
+    model.init(K, data->dim(), ModelInitTypes::random, false);
+    SubModel submodel = model.full();
+
+    const Eigen::MatrixXd &V = model.U(1);
+    Eigen::VectorXd rr = Eigen::VectorXd::Zero(K);
+    Eigen::MatrixXd MM = Eigen::MatrixXd::Zero(K, K);
+    init_bmrng(42);
+    data->getMuLambda(submodel, 0, 2, rr, MM);
+
+    // same random numbers, through the virtual noise model
+    init_bmrng(42);
+    Eigen::VectorXd expected_rr = Eigen::VectorXd::Zero(K);
+    for (int j = 0; j < 3; j++)
+      expected_rr += V.col(j) * data->noise().sample(submodel, {2, j}, 4. + j);
+
+    REQUIRE( (rr - expected_rr).norm() < 1e-10 );
+    REQUIRE( (MM - V * V.transpose()).norm() < 1e-10 );
+  }
+}
+
+TEST_CASE( "DenseMatrixData/getMuLambdaAll", "Batched getMuLambda gives the same result as getMuLambda of every item") {
+  Eigen::MatrixXd Y(7, 5);
+  for (int i = 0; i < 7; i++)
+    for (int j = 0; j < 5; j++)
+      Y(i, j) = std::sin(1.0 + i + 0.3 * j);
+
+  std::shared_ptr<Data> data(new DenseMatrixData(Y));
+  NoiseConfig ncfg(NoiseTypes::fixed);
+  ncfg.setPrecision(3.0);
+  data->setNoiseModel(NoiseFactory::create_noise_model(ncfg));
+  data->init();
+
+  const int K = 4;
+  init_bmrng(1234);
+  Model model;
+  model.init(K, data->dim(), ModelInitTypes::random, false);
+  SubModel submodel = model.full();
+
+  for (int mode = 0; mode < 2; mode++) {
+    data->update_pnm(submodel, mode);
+
+    Eigen::MatrixXd RR, MM_all;
+    REQUIRE( data->getMuLambdaAll(submodel, mode, RR, MM_all) );
+    REQUIRE( RR.cols() == model.U(mode).cols() );
+
+    for (int d = 0; d < RR.cols(); d++) {
+      Eigen::VectorXd rr = Eigen::VectorXd::Zero(K);
+      Eigen::MatrixXd MM = Eigen::MatrixXd::Zero(K, K);
+      data->getMuLambda(submodel, mode, d, rr, MM);
+      REQUIRE( (RR.col(d) - rr).norm() < 1e-10 );
+      REQUIRE( (MM_all - MM).norm() < 1e-10 );
+    }
+  }
+
+  // probit noise samples every observation, no batched form
+  NoiseConfig probit_ncfg(NoiseTypes::probit);
+  data->setNoiseModel(NoiseFactory::create_noise_model(probit_ncfg));
+  Eigen::MatrixXd RR, MM_all;
+  REQUIRE( !data->getMuLambdaAll(submodel, 0, RR, MM_all) );
+}
+
 TEST_CASE("macauprior/make_dense_prior", "Making MacauPrior with MatrixConfig") {
     std::vector<double> x = {0.1, 0.4, -0.7, 0.3, 0.11, 0.23};
 
@@ -199,10 +471,215 @@ TEST_CASE("macauprior/make_dense_prior", "Making MacauPrior with MatrixConfig")
     Ftrue <<  0.1, 0.3, 0.4, 0.11, -0.7, 0.23;
     auto features_downcast1 = std::dynamic_pointer_cast<DenseSideInfo>(prior->Features); //for the purpose of the test
     REQUIRE( (*(features_downcast1->get_features()) - Ftrue).norm() == Approx(0) );
-    Eigen::MatrixXd tmp = Eigen::MatrixXd::Zero(2, 2);
-    tmp.triangularView<Eigen::Lower>()  = prior->FtF_plus_precision;
-    tmp.triangularView<Eigen::Lower>() -= Ftrue.transpose() * Ftrue;
-    REQUIRE( tmp.norm() == Approx(0) );
+    Eigen::MatrixXd FtF = prior->FtF_eigenvectors * prior->FtF_eigenvalues.asDiagonal() * prior->FtF_eigenvectors.transpose();
+    REQUIRE( (FtF - Ftrue.transpose() * Ftrue).norm() == Approx(0) );
+}
+
+TEST_CASE("macauprior/sample_beta/direct", "Cached eigendecomposition solves (F'F + beta_precision I) beta' = Ft_y' for any beta_precision") {
+    const int nrows = 30, ncols = 12, nlatent = 3;
+    std::vector<double> x(nrows * ncols);
+    for (int i = 0; i < nrows * ncols; i++) x[i] = std::sin(1.3 * i) + 0.1 * (i % 7);
+
+    std::unique_ptr<MacauPrior> prior(make_dense_prior(nlatent, x, nrows, ncols, true));
+    Eigen::Map<Eigen::MatrixXd> F(x.data(), nrows, ncols);
+    Eigen::MatrixXd FtF = F.transpose() * F;
+
+    prior->m_beta = std::make_shared<Eigen::MatrixXd>(nlatent, ncols);
+    prior->Ft_y = Eigen::MatrixXd::Zero(nlatent, ncols);
+    for (int i = 0; i < nlatent; i++)
+       for (int j = 0; j < ncols; j++)
+          prior->Ft_y(i, j) = std::cos(0.7 * i + 0.3 * j);
+
+    for (double bp : {10.0, 0.5, 123.0})
+    {
+       prior->beta_precision = bp;
+       prior->sample_beta();
+
+       Eigen::MatrixXd A = FtF;
+       A.diagonal().array() += bp;
+       Eigen::MatrixXd expected = A.llt().solve(prior->Ft_y.transpose()).transpose();
+       REQUIRE( (prior->beta() - expected).norm() / expected.norm() < 1e-10 );
+    }
+}
+
+TEST_CASE("macauprior/sample_beta/dual", "Item space solver through F F' gives the same beta as the feature space solver") {
+    const int nrows = 8, ncols = 20, nlatent = 3;
+    std::vector<double> x(nrows * ncols);
+    for (int i = 0; i < nrows * ncols; i++) x[i] = std::sin(0.9 * i) + 0.2 * (i % 5);
+
+    REQUIRE( MacauPrior::choose_dual(nrows, ncols, false) );
+    REQUIRE( MacauPrior::choose_dual(nrows, ncols, true) );
+    REQUIRE( !MacauPrior::choose_dual(ncols, nrows, true) );
+    REQUIRE( !MacauPrior::choose_dual(100000, 200000, false) );
+    REQUIRE( !MacauPrior::choose_dual(nrows, nrows + 1, false) );
+    REQUIRE( MacauPrior::choose_dual(nrows, nrows + 1, true) );
+
+    std::unique_ptr<MacauPrior> prior(make_dense_prior(nlatent, x, nrows, ncols, false));
+    prior->use_dual = true;
+    prior->compute_FFt_eigen();
+
+    Eigen::Map<Eigen::MatrixXd> F(x.data(), nrows, ncols);
+    Eigen::MatrixXd FFt = F * F.transpose();
+    REQUIRE( (prior->FFt_eigenvectors * prior->FFt_eigenvalues.asDiagonal() * prior->FFt_eigenvectors.transpose() - FFt).norm() < 1e-10 );
+
+    prior->m_beta = std::make_shared<Eigen::MatrixXd>(nlatent, ncols);
+    prior->Ft_y = Eigen::MatrixXd::Zero(nlatent, ncols);
+    for (int i = 0; i < nlatent; i++)
+       for (int j = 0; j < ncols; j++)
+          prior->Ft_y(i, j) = std::cos(0.7 * i + 0.3 * j);
+
+    for (double bp : {10.0, 0.5, 123.0})
+    {
+       prior->beta_precision = bp;
+       prior->sample_beta();
+
+       Eigen::MatrixXd A = F.transpose() * F;
+       A.diagonal().array() += bp;
+       Eigen::MatrixXd expected = A.llt().solve(prior->Ft_y.transpose()).transpose();
+       REQUIRE( (prior->beta() - expected).norm() / expected.norm() < 1e-10 );
+    }
+}
+
+TEST_CASE("macauoneprior/choose_incremental_uhat", "Uhat is taken from the sweep residuals when that is cheaper than beta * F'") {
+    REQUIRE( MacauOnePrior::choose_incremental_uhat(1000, 100) );
+    REQUIRE( !MacauOnePrior::choose_incremental_uhat(50, 100) );
+
+    std::vector<uint32_t> rows = {0, 1, 2, 2}, cols = {0, 1, 0, 2};
+    auto mc = std::make_shared<MatrixConfig>(3, 3, rows, cols, std::vector<double>{1., 2., 3., 4.}, fixed_ncfg, false);
+    SparseSideInfo sf(mc);
+    REQUIRE( sf.nnz() == 4 );
+    REQUIRE( static_cast<ISideInfo&>(sf).nnz() == 4 );
+}
+
+TEST_CASE("threads/parallel_for", "Every index is visited once, tasks all run") {
+  const int n = 10007;
+  std::vector<int> visited(n, 0);
+  thread_vector<std::int64_t> sums(0);
+  threads::parallel_for(0, n, [&](std::int64_t i) {
+    visited[i]++;
+    sums.local() += i;
+  });
+
+  REQUIRE( std::count(visited.begin(), visited.end(), 1) == n );
+  REQUIRE( sums.combine() == (std::int64_t)n * (n - 1) / 2 );
+
+  // blocks of the static loop are contiguous and cover the range once
+  std::vector<int> covered(n, 0);
+  threads::parallel_for_static(0, n, [&](std::int64_t from, std::int64_t to) {
+    for (std::int64_t i = from; i < to; i++) covered[i]++;
+  });
+  REQUIRE( std::count(covered.begin(), covered.end(), 1) == n );
+
+  threads::task_group tasks;
+  int a = 0, b = 0;
+  tasks.run([&a]() { a = 1; });
+  tasks.run([&b]() { b = 2; });
+  tasks.wait();
+  REQUIRE( a + b == 3 );
+
+  threads::task_group failing;
+  failing.run([]() { THROWERROR("task failed"); });
+  REQUIRE_THROWS( failing.wait() );
+}
+
+TEST_CASE("WorkPartition", "Heavy items are split off, the rest is cut in balanced chunks") {
+  // power-law like costs: item 0 costs more than the share of one thread,
+  // items 1 and 2 more than a chunk of the rest
+  std::vector<std::int64_t> costs;
+  costs.push_back(100000);
+  for (int i = 1; i < 1000; i++)
+    costs.push_back(1 + 2000 / i);
+
+  WorkPartition partition(costs, 4);
+
+  REQUIRE( partition.num_items() == 1000 );
+  REQUIRE( partition.num_chunks() == 4 * WorkPartition::CHUNKS_PER_THREAD );
+  REQUIRE( partition.heavy_items().size() == 3 );
+  REQUIRE( partition.heavy_items()[0] == 0 );
+  REQUIRE( partition.is_heavy(0) );
+
+  // chunks cover all items in order
+  REQUIRE( partition.chunk_begin(0) == 0 );
+  REQUIRE( partition.chunk_end(partition.num_chunks() - 1) == 1000 );
+  for (int c = 1; c < partition.num_chunks(); c++)
+    REQUIRE( partition.chunk_begin(c) == partition.chunk_end(c - 1) );
+
+  // a chunk is never more than one item over its share
+  REQUIRE( partition.imbalance() < 1.5 );
+
+  // few, cheap items are never split
+  WorkPartition small(std::vector<std::int64_t>(3, 2), 8);
+  REQUIRE( small.num_chunks() == 3 );
+  REQUIRE( small.heavy_items().empty() );
+
+  // data that can not split items has no heavy items
+  WorkPartition unsplit(costs, 4, false);
+  REQUIRE( unsplit.heavy_items().empty() );
+  REQUIRE( unsplit.chunk_end(unsplit.num_chunks() - 1) == 1000 );
+}
+
+TEST_CASE("WorkPartition/uniform", "Near-uniform costs on many threads give no heavy items") {
+  std::vector<std::int64_t> costs;
+  for (int i = 0; i < 100; i++)
+    costs.push_back(100000 + (i * 37) % 1000);
+
+  WorkPartition partition(costs, 32);
+  REQUIRE( partition.heavy_items().empty() );
+  REQUIRE( partition.num_chunks() == 100 );
+
+  std::vector<std::int64_t> two_costs;
+  for (int i = 0; i < 50; i++)
+    two_costs.push_back(i % 2 ? 110000 : 90000);
+
+  WorkPartition two(two_costs, 32);
+  REQUIRE( two.heavy_items().empty() );
+  REQUIRE( two.num_chunks() == 50 );
+
+  // fewer items than threads: splitting them keeps all threads busy
+  WorkPartition few(std::vector<std::int64_t>(8, 100000), 32);
+  REQUIRE( few.heavy_items().size() == 8 );
+}
+
+TEST_CASE("BatchCholesky/solve", "Batched Cholesky solves match Eigen::LLT") {
+  const int K = 5;
+  init_bmrng(1234);
+
+  BatchCholesky batch(K);
+  std::vector<Eigen::MatrixXd> MMs;
+  std::vector<Eigen::VectorXd> rrs;
+
+  // one system less than a full batch, to exercise the padding
+  for (int b = 0; b < BatchCholesky::BATCH_SIZE - 1; b++) {
+    Eigen::MatrixXd A = nrandn(K, K).matrix();
+    Eigen::MatrixXd MM = A * A.transpose() + Eigen::MatrixXd::Identity(K, K);
+    Eigen::VectorXd rr = nrandn(K);
+    MMs.push_back(MM);
+    rrs.push_back(rr);
+    REQUIRE( batch.add(MM, rr) == b );
+  }
+
+  REQUIRE( batch.factorize() );
+  batch.solveL();
+  for (int b = 0; b < batch.size(); b++)
+    batch.add_rhs(b, Eigen::VectorXd::Ones(K));
+  batch.solveLt();
+
+  for (int b = 0; b < batch.size(); b++) {
+    Eigen::LLT<Eigen::MatrixXd> chol = MMs[b].llt();
+    Eigen::VectorXd expected = rrs[b];
+    chol.matrixL().solveInPlace(expected);
+    expected += Eigen::VectorXd::Ones(K);
+    chol.matrixU().solveInPlace(expected);
+
+    Eigen::VectorXd actual(K);
+    batch.get(b, actual);
+    REQUIRE( (actual - expected).norm() < 1e-10 );
+  }
+
+  // not positive definite
+  batch.clear();
+  batch.add(-Eigen::MatrixXd::Identity(K, K), Eigen::VectorXd::Zero(K));
+  REQUIRE( !batch.factorize() );
 }
 
 TEST_CASE("inv_norm_cdf/inv_norm_cdf", "Inverse normal CDF") {
@@ -212,6 +689,14 @@ TEST_CASE("inv_norm_cdf/inv_norm_cdf", "Inverse normal CDF") {
 	REQUIRE( inv_norm_cdf(0.01) == Approx(-2.3263478740408408) );
 }
 
+TEST_CASE("inv_norm_cdf/batch", "Batched inverse normal CDF is the scalar one") {
+	std::vector<double> y = {0.0, 1e-20, 0.01, 0.1, 0.2, 0.5, 0.8, 0.9, 0.99, 1.0 - 1e-12, 1.0};
+	std::vector<double> x(y.size());
+	inv_norm_cdf(y.size(), y.data(), x.data());
+	for (std::size_t i = 0; i < y.size(); i++)
+		REQUIRE( x[i] == inv_norm_cdf(y[i]) );
+}
+
 TEST_CASE("truncnorm/norm_cdf", "Normal CDF") {
 	REQUIRE( norm_cdf(0.0)  == Approx(0.5));
 	REQUIRE( norm_cdf(-1.0) == Approx(0.15865525393145707) );
@@ -230,6 +715,22 @@ TEST_CASE( "truncnorm/rand_truncnorm", "generaring random truncnorm variable" )
   }
 }
 
+TEST_CASE( "truncnorm/rand_truncnorm/batch", "Batched truncated normals are the scalar ones" ) {
+  std::vector<double> low_cut;
+  for (int i = 0; i < 300; i++)
+    low_cut.push_back((i % 23) / 2.5 - 4.0); // both sides of the rejection sampler cutoff 3.0
+
+  std::vector<double> x(low_cut.size());
+  init_bmrng(1234);
+  rand_truncnorm(low_cut.size(), low_cut.data(), x.data());
+
+  init_bmrng(1234);
+  for (std::size_t i = 0; i < low_cut.size(); i++) {
+    REQUIRE( x[i] == rand_truncnorm(low_cut[i]) );
+    REQUIRE( x[i] >= low_cut[i] );
+  }
+}
+
 TEST_CASE("Benchmark from old 'data.cpp' file", "[!hide]")
 {
    const int N = 32 * 1024;
@@ -433,4 +934,97 @@ TEST_CASE("rgamma", " [random]")
    REQUIRE(rnd == Approx(0.0270837).epsilon(APPROX_EPSILON));
    
    #endif
-}
\ No newline at end of file
+}
+
+TEST_CASE("Philox4x32/known_answer", "Philox4x32-10 matches the Random123 known answer tests")
+{
+   std::uint32_t out[4];
+
+   const std::uint32_t ctr0[4] = { 0, 0, 0, 0 };
+   const std::uint32_t key0[2] = { 0, 0 };
+   Philox4x32::generate(ctr0, key0, out);
+   REQUIRE(out[0] == 0x6627e8d5);
+   REQUIRE(out[1] == 0xe169c58d);
+   REQUIRE(out[2] == 0xbc57ac4c);
+   REQUIRE(out[3] == 0x9b00dbd8);
+
+   const std::uint32_t ctr1[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+   const std::uint32_t key1[2] = { 0xffffffff, 0xffffffff };
+   Philox4x32::generate(ctr1, key1, out);
+   REQUIRE(out[0] == 0x408f276d);
+   REQUIRE(out[1] == 0x41c83b0e);
+   REQUIRE(out[2] == 0xa20bc7c6);
+   REQUIRE(out[3] == 0x6d5451fd);
+}
+
+TEST_CASE("Philox4x32/streams", "Counter based samples depend on the stream, not on the thread count")
+{
+   const int num_threads = threads::get_max_threads();
+
+   threads::init(0, 1);
+   init_bmrng(1234, true);
+   set_rng_iteration(7);
+   select_rng_stream(1, 42);
+   double a = randn();
+   select_rng_stream(0, 3);
+   double b = randn();
+   select_rng_stream(1, 42);
+   REQUIRE(randn() == a);
+   REQUIRE(a != b);
+
+   Eigen::MatrixXd X(10, 1001);
+   select_rng_stream(-1, -1);
+   bmrandn(X);
+
+   threads::init(0, 3);
+   init_bmrng(1234, true);
+   set_rng_iteration(7);
+   Eigen::MatrixXd Y(10, 1001);
+   select_rng_stream(-1, -1);
+   bmrandn(Y);
+   REQUIRE(X == Y);
+   REQUIRE(std::abs(X.mean()) < 0.05);
+   REQUIRE(std::abs(X.squaredNorm() / X.size() - 1.0) < 0.05);
+
+   // bulk normals in parallel are the serial ones
+   Philox4x32 rng(1234);
+   rng.select(7, -1, -1, 0);
+   Eigen::MatrixXd Z(10, 1001);
+   rng.normals(Z.data(), Z.size());
+   REQUIRE(X == Z);
+
+   threads::init(0, num_threads);
+   init_bmrng(1234);
+}
+
+TEST_CASE("bmrandn/benchmark", "[!hide]")
+{
+   const int K = 64;
+   const int N = 64 * 1024;
+   const int R = 10;
+
+   for (bool counter_based : { false, true })
+   {
+      init_bmrng(1234, counter_based);
+      Eigen::MatrixXd X(K, N);
+
+      double start = tick();
+      for (int i = 0; i < R; ++i)
+         bmrandn(X);
+      double stop = tick();
+
+      std::cout << (counter_based ? "philox" : "mt19937") << " bmrandn: "
+                << (double)K * N * R / (stop - start) / 1e6 << " M normals/s, mean " << X.mean() << std::endl;
+
+      start = tick();
+      for (int i = 0; i < R; ++i)
+         for (int j = 0; j < N; ++j)
+            X.col(j) = nrandn(K);
+      stop = tick();
+
+      std::cout << (counter_based ? "philox" : "mt19937") << " nrandn: "
+                << (double)K * N * R / (stop - start) / 1e6 << " M normals/s, mean " << X.mean() << std::endl;
+   }
+
+   init_bmrng(1234);
+}